@@ -0,0 +1,110 @@
+#include "cbor.h"
+
+// Tipos maiores (3 bits altos do byte inicial)
+#define CBOR_UINT   0
+#define CBOR_NINT   1
+#define CBOR_BYTES  2
+#define CBOR_TEXT   3
+#define CBOR_ARRAY  4
+#define CBOR_MAP    5
+
+#define CBOR_FALSE  0xF4
+#define CBOR_TRUE   0xF5
+#define CBOR_NULL   0xF6
+#define CBOR_BREAK  0xFF
+#define CBOR_INDEF  31
+
+CborWriter::CborWriter(uint8_t* buf, size_t cap, CborSink sink, void* ctx)
+    : _buf(buf), _cap(cap), _sink(sink), _ctx(ctx) {}
+
+void CborWriter::flush() {
+    if (!_len || !_sink) return;   // bloco vazio encerraria o chunked
+    _sink(_ctx, _buf, _len);
+    _flushed += _len;
+    _len = 0;
+}
+
+void CborWriter::put(const uint8_t* p, size_t n) {
+    while (n) {
+        if (_len == _cap) {
+            if (!_sink) {
+                _overflow = true;
+                return;
+            }
+            flush();
+        }
+        size_t k = _cap - _len < n ? _cap - _len : n;
+        memcpy(_buf + _len, p, k);
+        _len += k;
+        p += k;
+        n -= k;
+    }
+}
+
+// Argumento no menor tamanho que couber (forma preferida da RFC)
+void CborWriter::head(uint8_t major, uint64_t v) {
+    uint8_t h[9];
+    size_t n;
+    uint8_t ib = major << 5;
+
+    if (v < 24) {
+        h[0] = ib | (uint8_t)v;
+        n = 1;
+    } else if (v <= 0xFF) {
+        h[0] = ib | 24;
+        n = 2;
+    } else if (v <= 0xFFFF) {
+        h[0] = ib | 25;
+        n = 3;
+    } else if (v <= 0xFFFFFFFFULL) {
+        h[0] = ib | 26;
+        n = 5;
+    } else {
+        h[0] = ib | 27;
+        n = 9;
+    }
+
+    for (size_t i = n - 1; i > 0; i--) {
+        h[i] = (uint8_t)v;
+        v >>= 8;
+    }
+    put(h, n);
+}
+
+void CborWriter::map(uint32_t pairs)   { head(CBOR_MAP, pairs); }
+void CborWriter::array(uint32_t items) { head(CBOR_ARRAY, items); }
+void CborWriter::beginMap()            { put((CBOR_MAP << 5) | CBOR_INDEF); }
+void CborWriter::beginArray()          { put((CBOR_ARRAY << 5) | CBOR_INDEF); }
+void CborWriter::end()                 { put(CBOR_BREAK); }
+
+void CborWriter::text(const char* s) {
+    text(s, s ? strlen(s) : 0);
+}
+
+void CborWriter::text(const char* s, size_t len) {
+    head(CBOR_TEXT, len);
+    put((const uint8_t*)s, len);
+}
+
+void CborWriter::bytes(const uint8_t* p, size_t len) {
+    head(CBOR_BYTES, len);
+    put(p, len);
+}
+
+void CborWriter::uinteger(uint64_t v) {
+    head(CBOR_UINT, v);
+}
+
+// Negativo n é codificado como -1 - n
+void CborWriter::integer(int64_t v) {
+    if (v < 0) head(CBOR_NINT, (uint64_t)(-1 - v));
+    else       head(CBOR_UINT, (uint64_t)v);
+}
+
+void CborWriter::boolean(bool v) {
+    put(v ? CBOR_TRUE : CBOR_FALSE);
+}
+
+void CborWriter::null() {
+    put(CBOR_NULL);
+}
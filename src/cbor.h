@@ -0,0 +1,61 @@
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <Arduino.h>
+
+// =========================
+// CODIFICADOR CBOR
+// =========================
+// RFC 8949, só o que as rotas e o MQTT usam. Escreve num buffer fixo do
+// chamador e, quando ele enche, entrega o bloco ao sink (sendContent,
+// por exemplo): nada é alocado, seja qual for o tamanho da resposta.
+// Sem sink, o que não cabe é descartado e overflow() fica true.
+// Mapas e arrays de tamanho conhecido levam o tamanho no cabeçalho; os
+// que crescem enquanto são escritos usam a forma indefinida + end().
+
+typedef void (*CborSink)(void* ctx, const uint8_t* data, size_t len);
+
+class CborWriter {
+public:
+    CborWriter(uint8_t* buf, size_t cap, CborSink sink = nullptr, void* ctx = nullptr);
+
+    void map(uint32_t pairs);
+    void array(uint32_t items);
+    void beginMap();          // tamanho indefinido, fechar com end()
+    void beginArray();
+    void end();
+
+    void key(const char* k) { text(k); }
+    void text(const char* s);
+    void text(const char* s, size_t len);
+    void bytes(const uint8_t* p, size_t len);
+    void uinteger(uint64_t v);
+    void integer(int64_t v);
+    void boolean(bool v);
+    void null();
+
+    // Entrega ao sink o que ainda está no buffer
+    void flush();
+
+    size_t size() const { return _flushed + _len; }   // bytes gerados até aqui
+    bool overflow() const { return _overflow; }
+
+    // Sem sink: o item inteiro fica no buffer
+    const uint8_t* data() const { return _buf; }
+    size_t length() const { return _len; }
+
+private:
+    uint8_t* _buf;
+    size_t   _cap;
+    size_t   _len = 0;
+    size_t   _flushed = 0;
+    bool     _overflow = false;
+    CborSink _sink;
+    void*    _ctx;
+
+    void head(uint8_t major, uint64_t v);
+    void put(const uint8_t* p, size_t n);
+    void put(uint8_t b) { put(&b, 1); }
+};
+
+#endif
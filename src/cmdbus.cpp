@@ -0,0 +1,108 @@
+#include "cmdbus.h"
+#include "log.h"
+
+#define CMD_QUEUE_MASK (CMD_QUEUE_LEN - 1)
+
+static_assert((CMD_QUEUE_LEN & CMD_QUEUE_MASK) == 0, "CMD_QUEUE_LEN precisa ser potência de 2");
+
+CommandBus::CommandBus() {
+    for (uint32_t i = 0; i < CMD_QUEUE_LEN; i++) {
+        _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+const char* CommandBus::sourceName(CmdSource s) {
+    switch (s) {
+        case SRC_BOOT:   return "boot";
+        case SRC_WEB:    return "web";
+        case SRC_MQTT:   return "mqtt";
+        case SRC_SWITCH: return "s2";
+        default:         return "?";
+    }
+}
+
+bool CommandBus::observe(std::function<void(const Transition&)> cb) {
+    if (_observerCount == CMD_MAX_OBSERVERS) return false;
+    _observers[_observerCount++] = cb;
+    return true;
+}
+
+// =========================
+// FILA MPSC
+// =========================
+// A célula livre para a posição p tem seq == p; o produtor que ganha o
+// CAS no head escreve o comando e publica seq = p + 1 para o consumidor,
+// que devolve a célula com seq = p + CMD_QUEUE_LEN.
+bool CommandBus::post(CmdOp op, bool value, CmdSource source) {
+    uint32_t pos = _head.load(std::memory_order_relaxed);
+    Cell* cell;
+
+    for (;;) {
+        cell = &_cells[pos & CMD_QUEUE_MASK];
+        uint32_t seq = cell->seq.load(std::memory_order_acquire);
+        int32_t dif = (int32_t)(seq - pos);
+
+        if (dif == 0) {
+            if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (dif < 0) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;   // cheia
+        } else {
+            pos = _head.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->cmd = {op, value, source, millis()};
+    cell->seq.store(pos + 1, std::memory_order_release);
+    _posted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool CommandBus::pop(Command& out) {
+    Cell& cell = _cells[_tail & CMD_QUEUE_MASK];
+    uint32_t seq = cell.seq.load(std::memory_order_acquire);
+    if ((int32_t)(seq - (_tail + 1)) < 0) return false;   // vazia
+
+    out = cell.cmd;
+    cell.seq.store(_tail + CMD_QUEUE_LEN, std::memory_order_release);
+    _tail++;
+    return true;
+}
+
+// =========================
+// DONO DO ESTADO
+// =========================
+void CommandBus::loop() {
+    Command c;
+    while (pop(c)) {
+        bool base = _pending ? _pendingState : _state;
+        _pendingState = c.op == CMD_SET ? c.value : !base;
+        _pendingLast = c;
+        _pendingCount++;
+        _pending = true;
+    }
+    if (!_pending) return;
+
+    // Segura o relé: o que chegar na janela entra na mesma dobra
+    uint32_t now = millis();
+    if (_seq && now - _last.appliedAt < CMD_COALESCE_MS) return;
+
+    uint32_t folded = _pendingCount;
+    _pending = false;
+    _pendingCount = 0;
+
+    if (_pendingState == _state) {
+        // A rajada se anulou (ou repetiu o estado atual)
+        _coalesced += folded;
+        return;
+    }
+    _coalesced += folded - 1;
+
+    _state = _pendingState;
+    _last = {++_seq, _state, _pendingLast.source, _pendingLast.at, now, folded};
+
+    LOGD("BUS", "#%lu %s por %s (%u comandos)", (unsigned long)_last.seq,
+         _state ? "ligada" : "desligada", sourceName(_last.source), (unsigned)folded);
+
+    for (size_t i = 0; i < _observerCount; i++) _observers[i](_last);
+}
@@ -0,0 +1,105 @@
+#ifndef CMDBUS_H
+#define CMDBUS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+
+// =========================
+// BARRAMENTO DE COMANDOS
+// =========================
+// Web, MQTT e S2 não mexem mais no estado: postam comandos numa fila
+// MPSC sem lock (ring limitado com número de sequência por célula, à la
+// Vyukov), e só o loop() do barramento aplica. Comandos que chegam juntos
+// (ou dentro de CMD_COALESCE_MS da última transição) são dobrados num
+// estado final só; se o final é o estado atual, nada acontece. Cada
+// transição aplicada ganha seq monotônico, origem e instante, e é
+// entregue na mesma ordem a todos os observadores (relé, MQTT, UI, uso).
+
+#define CMD_QUEUE_LEN     16        // potência de 2
+#define CMD_COALESCE_MS   100       // janela mínima entre transições do relé
+#define CMD_MAX_OBSERVERS 6
+
+enum CmdSource : uint8_t {
+    SRC_BOOT,
+    SRC_WEB,
+    SRC_MQTT,
+    SRC_SWITCH,
+    SRC_COUNT
+};
+
+enum CmdOp : uint8_t {
+    CMD_SET,
+    CMD_TOGGLE,
+};
+
+struct Command {
+    CmdOp     op;
+    bool      value;     // só para CMD_SET
+    CmdSource source;
+    uint32_t  at;        // millis() do post
+};
+
+struct Transition {
+    uint32_t  seq;
+    bool      on;
+    CmdSource source;    // origem do último comando dobrado
+    uint32_t  at;        // millis() do post desse comando
+    uint32_t  appliedAt; // millis() da aplicação
+    uint32_t  folded;    // comandos dobrados nesta transição
+};
+
+class CommandBus {
+public:
+    CommandBus();
+
+    // Qualquer task; falha só com a fila cheia
+    bool post(CmdOp op, bool value, CmdSource source);
+    bool set(bool on, CmdSource source) { return post(CMD_SET, on, source); }
+    bool toggle(CmdSource source) { return post(CMD_TOGGLE, false, source); }
+
+    // Dono único do estado: drena, dobra e aplica (só na task do loop)
+    void loop();
+    bool observe(std::function<void(const Transition&)> cb);
+
+    bool state() const { return _state; }
+    uint32_t seq() const { return _seq; }
+    const Transition& last() const { return _last; }
+
+    uint32_t posted() const { return _posted.load(std::memory_order_relaxed); }
+    uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+    uint32_t coalesced() const { return _coalesced; }
+
+    static const char* sourceName(CmdSource s);
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> seq;
+        Command cmd;
+    };
+
+    Cell _cells[CMD_QUEUE_LEN];
+    std::atomic<uint32_t> _head{0};   // produtores
+    uint32_t _tail = 0;               // só o consumidor
+
+    std::atomic<uint32_t> _posted{0};
+    std::atomic<uint32_t> _dropped{0};
+
+    // Comandos já drenados esperando a janela de coalescência
+    bool     _pending = false;
+    bool     _pendingState = false;
+    Command  _pendingLast;
+    uint32_t _pendingCount = 0;
+
+    bool       _state = false;
+    uint32_t   _seq = 0;
+    uint32_t   _coalesced = 0;
+    Transition _last = {};
+
+    std::function<void(const Transition&)> _observers[CMD_MAX_OBSERVERS];
+    size_t _observerCount = 0;
+
+    bool pop(Command& out);
+};
+
+#endif
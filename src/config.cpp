@@ -0,0 +1,229 @@
+#include "config.h"
+#include "log.h"
+#include <Preferences.h>
+
+static const char* CONFIG_NS = "config";
+static const char* SLOT_KEYS[2] = {"slot0", "slot1"};
+
+#define CONFIG_BLOB_MAX 1024
+
+struct BlobHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;         // bytes de ConfigData gravados
+    uint32_t generation;
+};
+
+uint32_t blobCrc32(const uint8_t* p, size_t n) {
+    uint32_t crc = 0xFFFFFFFF;
+    while (n--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static void terminate(ConfigData& d) {
+    d.legacySsid[sizeof(d.legacySsid) - 1] = '\0';
+    d.legacyPass[sizeof(d.legacyPass) - 1] = '\0';
+    d.mqttHost[sizeof(d.mqttHost) - 1] = '\0';
+    d.topic[sizeof(d.topic) - 1]       = '\0';
+    d.hostname[sizeof(d.hostname) - 1] = '\0';
+    for (uint8_t i = 0; i < WIFI_MAX_NETS; i++) {
+        d.nets[i].ssid[sizeof(d.nets[i].ssid) - 1] = '\0';
+        d.nets[i].pass[sizeof(d.nets[i].pass) - 1] = '\0';
+    }
+}
+
+bool Config::assign(char* dst, size_t cap, const char* src) {
+    size_t len = strlen(src);
+    if (len >= cap) return false;
+    memcpy(dst, src, len + 1);
+    return true;
+}
+
+void Config::defaults(ConfigData& d) {
+    memset(&d, 0, sizeof(d));
+    assign(d.mqttHost, sizeof(d.mqttHost), DEFAULT_MQTT_HOST);
+    d.mqttPort = DEFAULT_MQTT_PORT;
+    assign(d.topic, sizeof(d.topic), DEFAULT_TOPIC);
+    assign(d.hostname, sizeof(d.hostname), DEFAULT_HOSTNAME);
+    d.loopBudgetMs = DEFAULT_LOOP_BUDGET_MS;
+    addNetwork(d, DEFAULT_WIFI_SSID, DEFAULT_WIFI_PASS);
+    d.lampWatts = DEFAULT_LAMP_WATTS;
+    d.mqttCbor = DEFAULT_MQTT_CBOR;
+}
+
+const char* Config::validate(const ConfigData& d) {
+    if (!d.mqttHost[0])  return "Host MQTT inválido";
+    if (d.mqttPort == 0) return "Porta MQTT inválida";
+    if (!d.topic[0] || strpbrk(d.topic, "#+")) return "Tópico inválido";
+    if (!d.hostname[0])  return "Hostname inválido";
+    if (d.loopBudgetMs < 5 || d.loopBudgetMs > 5000) return "Orçamento do loop inválido";
+    if (d.lampWatts > 5000) return "Potência inválida";
+    if (d.mqttCbor > 1) return "Modo CBOR inválido";
+    for (uint8_t i = 1; i < WIFI_MAX_NETS; i++) {
+        if (d.nets[i].ssid[0] && !d.nets[i - 1].ssid[0]) return "Lista de redes inválida";
+    }
+    return nullptr;
+}
+
+// Campos que o blob gravado não tinha (ou que caíram no padding dele)
+// recebem o padrão explicitamente
+static void migrate(ConfigData& d, uint16_t fromVersion) {
+    if (fromVersion < 2) d.loopBudgetMs = DEFAULT_LOOP_BUDGET_MS;
+    if (fromVersion < 3) {
+        // A rede única vira a primeira (e por ora única) da lista
+        memset(d.nets, 0, sizeof(d.nets));
+        Config::addNetwork(d, d.legacySsid, d.legacyPass);
+        memset(d.legacySsid, 0, sizeof(d.legacySsid));
+        memset(d.legacyPass, 0, sizeof(d.legacyPass));
+    }
+    if (fromVersion < 4) d.lampWatts = DEFAULT_LAMP_WATTS;
+    if (fromVersion < 5) d.mqttCbor = DEFAULT_MQTT_CBOR;
+}
+
+// A lista de redes é aplicada ao vivo pelo WifiManager; o hostname só
+// vale depois de reassociar
+bool Config::needsRestart(const ConfigData& a, const ConfigData& b) {
+    return strcmp(a.hostname, b.hostname) != 0;
+}
+
+// =========================
+// REDES SALVAS
+// =========================
+int8_t Config::findNetwork(const ConfigData& d, const char* ssid) {
+    for (uint8_t i = 0; i < WIFI_MAX_NETS && d.nets[i].ssid[0]; i++) {
+        if (strcmp(d.nets[i].ssid, ssid) == 0) return i;
+    }
+    return -1;
+}
+
+// Entra (ou sobe) no topo da lista; com a lista cheia a de menor
+// prioridade sai
+bool Config::addNetwork(ConfigData& d, const char* ssid, const char* pass) {
+    WifiNet net;
+    memset(&net, 0, sizeof(net));
+    if (!ssid[0] || !assign(net.ssid, sizeof(net.ssid), ssid) ||
+        !assign(net.pass, sizeof(net.pass), pass)) return false;
+
+    int8_t at = findNetwork(d, ssid);
+    uint8_t last = at >= 0 ? at : WIFI_MAX_NETS - 1;
+    memmove(&d.nets[1], &d.nets[0], sizeof(WifiNet) * last);
+    d.nets[0] = net;
+    return true;
+}
+
+bool Config::removeNetwork(ConfigData& d, const char* ssid) {
+    int8_t at = findNetwork(d, ssid);
+    if (at < 0) return false;
+    memmove(&d.nets[at], &d.nets[at + 1], sizeof(WifiNet) * (WIFI_MAX_NETS - 1 - at));
+    memset(&d.nets[WIFI_MAX_NETS - 1], 0, sizeof(WifiNet));
+    return true;
+}
+
+// =========================
+// LOAD
+// =========================
+void Config::begin() {
+    ConfigData slots[2];
+    uint32_t gens[2];
+    bool ok[2];
+
+    for (uint8_t i = 0; i < 2; i++) ok[i] = readSlot(i, slots[i], gens[i]);
+
+    if (ok[0] || ok[1]) {
+        uint8_t best = !ok[0] ? 1 : !ok[1] ? 0 : ((int32_t)(gens[1] - gens[0]) > 0 ? 1 : 0);
+        _data = slots[best];
+        _generation = gens[best];
+        _slot = best;
+        LOGI("CFG", "Carregada geração %lu do slot %u",
+             (unsigned long)_generation, (unsigned)_slot);
+        if (!ok[best ^ 1]) LOGW("CFG", "Slot %u inválido, ignorado", (unsigned)(best ^ 1));
+        return;
+    }
+
+    // Primeiro boot (ou os dois slots corrompidos): padrões + credenciais
+    // antigas do namespace "wifi", se existirem
+    defaults(_data);
+
+    Preferences prefs;
+    prefs.begin("wifi", true);
+    String ssid = prefs.getString("ssid", "");
+    String pass = prefs.getString("pass", "");
+    prefs.end();
+
+    if (ssid.length() && addNetwork(_data, ssid.c_str(), pass.c_str())) {
+        LOGI("CFG", "Wi-Fi migrado do namespace antigo");
+    }
+
+    ConfigData initial = _data;
+    commit(initial);
+}
+
+bool Config::readSlot(uint8_t slot, ConfigData& out, uint32_t& generation) {
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NS, true)) return false;
+
+    uint8_t buf[CONFIG_BLOB_MAX];
+    size_t len = prefs.getBytesLength(SLOT_KEYS[slot]);
+    bool ok = len >= sizeof(BlobHeader) + 4 && len <= sizeof(buf) &&
+              prefs.getBytes(SLOT_KEYS[slot], buf, len) == len;
+    prefs.end();
+    if (!ok) return false;
+
+    BlobHeader h;
+    memcpy(&h, buf, sizeof(h));
+    if (h.magic != CONFIG_MAGIC || len != sizeof(h) + h.size + 4) return false;
+
+    uint32_t crc;
+    memcpy(&crc, buf + len - 4, 4);
+    if (blobCrc32(buf, len - 4) != crc) return false;
+
+    defaults(out);
+    memcpy(&out, buf + sizeof(h), h.size < sizeof(out) ? h.size : sizeof(out));
+    terminate(out);
+    migrate(out, h.version);
+
+    generation = h.generation;
+    return true;
+}
+
+// =========================
+// COMMIT
+// =========================
+bool Config::writeSlot(uint8_t slot, const ConfigData& d, uint32_t generation) {
+    uint8_t buf[sizeof(BlobHeader) + sizeof(ConfigData) + 4];
+
+    BlobHeader h = {CONFIG_MAGIC, CONFIG_VERSION, sizeof(ConfigData), generation};
+    memcpy(buf, &h, sizeof(h));
+    memcpy(buf + sizeof(h), &d, sizeof(d));
+    uint32_t crc = blobCrc32(buf, sizeof(h) + sizeof(d));
+    memcpy(buf + sizeof(h) + sizeof(d), &crc, 4);
+
+    Preferences prefs;
+    if (!prefs.begin(CONFIG_NS, false)) return false;
+    bool ok = prefs.putBytes(SLOT_KEYS[slot], buf, sizeof(buf)) == sizeof(buf);
+    prefs.end();
+    return ok;
+}
+
+bool Config::commit(const ConfigData& next) {
+    ConfigData clean = next;
+    terminate(clean);
+
+    uint8_t target = _slot ^ 1;
+    if (!writeSlot(target, clean, _generation + 1)) {
+        LOGE("CFG", "Falha ao gravar slot %u", (unsigned)target);
+        return false;
+    }
+
+    ConfigData before = _data;
+    _data = clean;
+    _generation++;
+    _slot = target;
+    LOGI("CFG", "Geração %lu gravada no slot %u", (unsigned long)_generation, (unsigned)_slot);
+
+    if (_onChange) _onChange(before);
+    return true;
+}
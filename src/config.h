@@ -0,0 +1,89 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <Arduino.h>
+#include <functional>
+
+// =========================
+// PADRÕES (primeiro boot)
+// =========================
+#define DEFAULT_WIFI_SSID "uaifai_IoT"
+#define DEFAULT_WIFI_PASS "supersuper"
+#define DEFAULT_MQTT_HOST "192.168.0.127"
+#define DEFAULT_MQTT_PORT 1883
+#define DEFAULT_TOPIC     "casa/lavanderia/lampada"
+#define DEFAULT_HOSTNAME  "lampada_lavanderia"
+#define DEFAULT_LOOP_BUDGET_MS 100
+#define DEFAULT_LAMP_WATTS 0         // 0 = desconhecida, sem estimativa de kWh
+#define DEFAULT_MQTT_CBOR  0         // 1 = estado também em CBOR em <topic>/cbor
+
+#define CONFIG_MAGIC   0x504D414C   // "LAMP"
+#define CONFIG_VERSION 5
+
+#define WIFI_MAX_NETS 5
+
+struct WifiNet {
+    char ssid[33];   // vazio = posição livre
+    char pass[65];
+};
+
+// Toda a configuração de runtime. Campos novos entram SEMPRE no fim e
+// sobem CONFIG_VERSION: um blob antigo é copiado por cima dos padrões,
+// então o que ele não tem fica com o valor default.
+struct ConfigData {
+    // v1: rede única, só lida na migração para nets[] (v3)
+    char     legacySsid[33];
+    char     legacyPass[65];
+    char     mqttHost[64];
+    uint16_t mqttPort;
+    char     topic[96];
+    char     hostname[33];
+    // v2
+    uint16_t loopBudgetMs;
+    // v3: redes salvas em ordem de prioridade, sem buracos
+    WifiNet  nets[WIFI_MAX_NETS];
+    // v4
+    uint16_t lampWatts;
+    // v5
+    uint8_t  mqttCbor;
+};
+
+// CRC32 (IEEE) dos blobs gravados na NVS
+uint32_t blobCrc32(const uint8_t* p, size_t n);
+
+// Carregada uma vez no boot e mantida em RAM. Gravada em dois slots NVS
+// alternados, cada um com versão, geração e CRC32: o commit escreve no
+// slot mais antigo, então uma gravação interrompida nunca perde a
+// configuração anterior.
+class Config {
+public:
+    void begin();
+
+    const ConfigData& get() const { return _data; }
+    bool commit(const ConfigData& next);
+
+    uint32_t generation() const { return _generation; }
+    uint8_t slot() const { return _slot; }
+
+    void onChange(std::function<void(const ConfigData& before)> cb) { _onChange = cb; }
+
+    static void defaults(ConfigData& d);
+    static const char* validate(const ConfigData& d);
+    static bool needsRestart(const ConfigData& a, const ConfigData& b);
+    static bool assign(char* dst, size_t cap, const char* src);
+
+    static int8_t findNetwork(const ConfigData& d, const char* ssid);
+    static bool addNetwork(ConfigData& d, const char* ssid, const char* pass);
+    static bool removeNetwork(ConfigData& d, const char* ssid);
+
+private:
+    ConfigData _data;
+    uint32_t   _generation = 0;
+    uint8_t    _slot = 1;
+    std::function<void(const ConfigData&)> _onChange;
+
+    bool readSlot(uint8_t slot, ConfigData& out, uint32_t& generation);
+    bool writeSlot(uint8_t slot, const ConfigData& d, uint32_t generation);
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "heaptrace.h"
+
+#ifdef HEAP_TRACE
+
+#include "log.h"
+#include <esp_heap_caps.h>
+
+HeapScopeStats HeapTrace::_stats[HEAPTRACE_MAX_SCOPES];
+size_t         HeapTrace::_count = 0;
+HeapScope*     HeapTrace::_current = nullptr;
+
+// Task dona do escopo aberto; outras tasks (Wi-Fi, lwIP, log) nunca tocam
+// em _current, então não há corrida com o fechamento do escopo.
+static void* volatile s_owner = nullptr;
+
+static uint32_t freeNow() {
+    return heap_caps_get_free_size(MALLOC_CAP_8BIT);
+}
+
+void HeapTrace::onAlloc(size_t size) {
+    // Sem escopo aberto (inclusive antes do scheduler) nem pergunta a task
+    void* owner = s_owner;
+    if (!owner || owner != xTaskGetCurrentTaskHandle()) return;
+
+    HeapScope* s = _current;
+    s->_allocs++;
+    s->_bytes += size;
+
+    uint32_t f = freeNow();
+    if (f < s->_minFree) s->_minFree = f;
+}
+
+HeapScopeStats* HeapTrace::find(const char* name) {
+    for (size_t i = 0; i < _count; i++) {
+        if (_stats[i].name == name || strcmp(_stats[i].name, name) == 0) return &_stats[i];
+    }
+    return nullptr;
+}
+
+// Nomes guardados por ponteiro: só literais/estáticos chegam aqui
+HeapScopeStats* HeapTrace::acquire(const char* name) {
+    HeapScopeStats* found = find(name);
+    if (found || _count == HEAPTRACE_MAX_SCOPES) return found;
+
+    HeapScopeStats& s = _stats[_count++];
+    memset(&s, 0, sizeof(s));
+    s.name = name;
+    s.minLargestAfter = UINT32_MAX;
+    return &s;
+}
+
+void HeapTrace::declare(const char* name) {
+    acquire(name);
+}
+
+void HeapTrace::setBudget(const char* name, uint32_t bytes) {
+    HeapScopeStats* s = acquire(name);
+    if (s) s->budget = bytes;
+}
+
+void HeapTrace::reset() {
+    for (size_t i = 0; i < _count; i++) {
+        HeapScopeStats& s = _stats[i];
+        uint32_t budget = s.budget;
+        const char* name = s.name;
+        memset(&s, 0, sizeof(s));
+        s.name = name;
+        s.budget = budget;
+        s.minLargestAfter = UINT32_MAX;
+    }
+}
+
+HeapScope::HeapScope(const char* name) {
+    _stats = HeapTrace::acquire(name);
+    _prev  = HeapTrace::_current;
+    _task  = xTaskGetCurrentTaskHandle();
+
+    if (_stats) _stats->largestBefore = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    _freeStart = _minFree = freeNow();
+
+    HeapTrace::_current = this;
+    s_owner = _task;
+}
+
+HeapScope::~HeapScope() {
+    uint32_t freeEnd = freeNow();
+
+    HeapTrace::_current = _prev;
+    s_owner = _prev ? _prev->_task : nullptr;
+
+    if (!_stats) return;
+
+    if (freeEnd < _minFree) _minFree = freeEnd;
+    uint32_t peak = _freeStart - _minFree;
+
+    HeapScopeStats& s = *_stats;
+    s.calls++;
+    s.allocs      += _allocs;
+    s.bytes       += _bytes;
+    s.lastPeak     = peak;
+    s.lastRetained = (int32_t)(_freeStart - freeEnd);
+    s.largestAfter = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    if (peak > s.peak) s.peak = peak;
+    if (s.largestAfter < s.minLargestAfter) s.minLargestAfter = s.largestAfter;
+
+    if (s.budget && peak > s.budget) {
+        s.overBudget++;
+        LOGW("HEAP", "%s: pico %u B acima do orçamento %u B",
+             s.name, (unsigned)peak, (unsigned)s.budget);
+    }
+}
+
+// =========================
+// WRAPPERS DO LINKER
+// =========================
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc redireciona todas as
+// chamadas (String, new, libs) para cá.
+#ifdef ESP_PLATFORM
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    void* p = __real_malloc(size);
+    if (p) HeapTrace::onAlloc(size);
+    return p;
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    void* p = __real_calloc(n, size);
+    if (p) HeapTrace::onAlloc(n * size);
+    return p;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    void* p = __real_realloc(ptr, size);
+    if (p && size) HeapTrace::onAlloc(size);
+    return p;
+}
+}
+#endif
+
+#endif
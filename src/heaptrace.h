@@ -0,0 +1,79 @@
+#ifndef HEAPTRACE_H
+#define HEAPTRACE_H
+
+#include <Arduino.h>
+
+// =========================
+// RASTREIO DE HEAP POR ROTA
+// =========================
+// Opcional: só existe com -DHEAP_TRACE (env mini_r4_heaptrace). Cada
+// HEAP_SCOPE(nome) conta as alocações feitas pela task atual enquanto o
+// escopo está aberto (malloc/calloc/realloc via --wrap no linker) e
+// amostra o heap livre e o maior bloco antes e depois.
+
+#define HEAPTRACE_MAX_SCOPES 24
+
+struct HeapScopeStats {
+    const char* name;
+    uint32_t calls;
+    uint32_t allocs;         // total de alocações
+    uint32_t bytes;          // total de bytes pedidos
+    uint32_t peak;           // maior (livre na entrada - menor livre durante)
+    uint32_t lastPeak;
+    int32_t  lastRetained;   // livre na entrada - livre na saída
+    uint32_t largestBefore;  // maior bloco livre, última chamada
+    uint32_t largestAfter;
+    uint32_t minLargestAfter;
+    uint32_t budget;         // 0 = sem orçamento
+    uint32_t overBudget;
+};
+
+class HeapScope;
+
+class HeapTrace {
+public:
+    static void onAlloc(size_t size);
+
+    static HeapScopeStats* find(const char* name);
+    // Registra o escopo já no boot (nome literal), antes da primeira chamada
+    static void declare(const char* name);
+    static void setBudget(const char* name, uint32_t bytes);
+    static void reset();
+
+    static size_t count() { return _count; }
+    static const HeapScopeStats& at(size_t i) { return _stats[i]; }
+
+private:
+    static HeapScopeStats _stats[HEAPTRACE_MAX_SCOPES];
+    static size_t _count;
+    static HeapScope* _current;
+
+    static HeapScopeStats* acquire(const char* name);
+
+    friend class HeapScope;
+};
+
+class HeapScope {
+public:
+    explicit HeapScope(const char* name);
+    ~HeapScope();
+
+private:
+    HeapScopeStats* _stats;
+    HeapScope*      _prev;
+    void*           _task;
+    uint32_t        _freeStart;
+    uint32_t        _minFree;
+    uint32_t        _allocs = 0;
+    uint32_t        _bytes = 0;
+
+    friend class HeapTrace;
+};
+
+#ifdef HEAP_TRACE
+#define HEAP_SCOPE(name) HeapScope _heapScope(name)
+#else
+#define HEAP_SCOPE(name) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,102 @@
+#include "log.h"
+#include <stdarg.h>
+
+Logger Log;
+
+static void logDrainTask(void* arg) {
+    Logger* log = static_cast<Logger*>(arg);
+    for (;;) {
+        if (log->drain(8) == 0) {
+            vTaskDelay(pdMS_TO_TICKS(20));
+        }
+    }
+}
+
+void Logger::begin() {
+    // Core 0, prioridade baixa: a UART nunca segura o loop() (core 1)
+    xTaskCreatePinnedToCore(logDrainTask, "log", 3072, this, 1, nullptr, 0);
+}
+
+void Logger::write(uint8_t level, const char* tag, const char* fmt, ...) {
+    uint32_t seq = _head.fetch_add(1, std::memory_order_relaxed);
+    Slot& s = _slots[seq & (LOG_SLOTS - 1)];
+
+    s.stamp.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s.ms    = millis();
+    s.level = level;
+    s.tag   = tag;
+
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(s.text, LOG_LINE_MAX, fmt, ap);
+    va_end(ap);
+
+    s.stamp.store(seq + 1, std::memory_order_release);
+}
+
+bool Logger::read(uint32_t seq, LogEntry& out) const {
+    const Slot& s = _slots[seq & (LOG_SLOTS - 1)];
+
+    uint32_t stamp = s.stamp.load(std::memory_order_acquire);
+    if (stamp != seq + 1) return false;
+
+    out.seq   = seq;
+    out.ms    = s.ms;
+    out.level = s.level;
+    out.tag   = s.tag;
+    memcpy(out.text, s.text, LOG_LINE_MAX);
+    out.text[LOG_LINE_MAX - 1] = '\0';
+
+    // Se o writer deu a volta no buffer durante a cópia, descarta
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s.stamp.load(std::memory_order_relaxed) == stamp;
+}
+
+uint32_t Logger::oldest() const {
+    uint32_t h = head();
+    return h > LOG_SLOTS ? h - LOG_SLOTS : 0;
+}
+
+size_t Logger::drain(size_t maxEntries) {
+    LogEntry e;
+    char line[LOG_LINE_MAX + 32];
+    size_t n = 0;
+
+    while (n < maxEntries && _drained != head()) {
+        uint32_t first = oldest();
+        if ((int32_t)(_drained - first) < 0) {
+            // UART não acompanhou: entradas já foram sobrescritas
+            _dropped.fetch_add(first - _drained, std::memory_order_relaxed);
+            _drained = first;
+        }
+
+        if (!read(_drained, e)) {
+            if ((int32_t)(head() - _drained) < LOG_SLOTS) break;   // ainda sendo escrita
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            _drained++;
+            continue;
+        }
+
+        size_t len = format(e, line, sizeof(line));
+        Serial.write((const uint8_t*)line, len);
+        _drained++;
+        n++;
+    }
+    return n;
+}
+
+size_t Logger::format(const LogEntry& e, char* buf, size_t cap) {
+    static const char LEVELS[] = "-EWID";
+    char lvl = e.level <= LOG_LVL_DEBUG ? LEVELS[e.level] : '?';
+
+    int n = snprintf(buf, cap, "[%7lu][%c][%s] %s\n",
+                     (unsigned long)e.ms, lvl, e.tag, e.text);
+    if (n < 0) return 0;
+    if ((size_t)n >= cap) {
+        buf[cap - 2] = '\n';
+        return cap - 1;
+    }
+    return n;
+}
@@ -0,0 +1,92 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// =========================
+// NÍVEIS DE LOG
+// =========================
+// O nível é fixado em tempo de compilação (-DLOG_LEVEL=n no platformio.ini).
+// Chamadas acima do nível viram ((void)0) e não custam nada no loop.
+#define LOG_LVL_NONE  0
+#define LOG_LVL_ERROR 1
+#define LOG_LVL_WARN  2
+#define LOG_LVL_INFO  3
+#define LOG_LVL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LVL_INFO
+#endif
+
+#define LOG_SLOTS    64     // potência de 2
+#define LOG_LINE_MAX 96     // texto já formatado, truncado se passar disso
+
+struct LogEntry {
+    uint32_t    seq;
+    uint32_t    ms;
+    uint8_t     level;
+    const char* tag;
+    char        text[LOG_LINE_MAX];
+};
+
+// Buffer circular em RAM. Quem loga só formata no slot (sem heap) e segue;
+// a UART é drenada por uma task separada. Leitores (drain e /logs) validam
+// o slot pelo número de sequência, então nunca bloqueiam quem escreve.
+class Logger {
+public:
+    void begin();
+
+    void write(uint8_t level, const char* tag, const char* fmt, ...)
+        __attribute__((format(printf, 4, 5)));
+
+    bool read(uint32_t seq, LogEntry& out) const;
+    uint32_t head() const { return _head.load(std::memory_order_acquire); }
+    uint32_t oldest() const;
+    uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+    size_t drain(size_t maxEntries);
+    static size_t format(const LogEntry& e, char* buf, size_t cap);
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> stamp{0};   // seq+1 quando pronto, 0 durante escrita
+        uint32_t    ms = 0;
+        uint8_t     level = 0;
+        const char* tag = "";
+        char        text[LOG_LINE_MAX];
+    };
+
+    Slot _slots[LOG_SLOTS];
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _dropped{0};
+    uint32_t _drained = 0;
+};
+
+extern Logger Log;
+
+#if LOG_LEVEL >= LOG_LVL_ERROR
+#define LOGE(tag, fmt, ...) Log.write(LOG_LVL_ERROR, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGE(tag, fmt, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LVL_WARN
+#define LOGW(tag, fmt, ...) Log.write(LOG_LVL_WARN, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGW(tag, fmt, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LVL_INFO
+#define LOGI(tag, fmt, ...) Log.write(LOG_LVL_INFO, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGI(tag, fmt, ...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LVL_DEBUG
+#define LOGD(tag, fmt, ...) Log.write(LOG_LVL_DEBUG, tag, fmt, ##__VA_ARGS__)
+#else
+#define LOGD(tag, fmt, ...) ((void)0)
+#endif
+
+#endif
@@ -3,20 +3,16 @@
 #include <WebServer.h>
 #include <Update.h>
 #include <Arduino.h>
-#include <Preferences.h>
 #include "webpage.h"
-
-// =========================
-// CONFIGURATIONS
-// =========================
-const char* WIFI_SSID = "uaifai_IoT";   // default
-const char* WIFI_PASS = "supersuper";
-
-const char* MQTT_HOST = "192.168.0.127";
-const uint16_t MQTT_PORT = 1883;
-
-const char* TOPIC    = "casa/lavanderia/lampada";
-const char* HOSTNAME = "lampada_lavanderia";
+#include "config.h"
+#include "wifimgr.h"
+#include "usage.h"
+#include "cmdbus.h"
+#include "cbor.h"
+#include "log.h"
+#include "heaptrace.h"
+#include "stall.h"
+#include "resolver.h"
 
 // =========================
 // PIN DEFINITIONS (Mini R4)
@@ -26,142 +22,243 @@ const char* HOSTNAME = "lampada_lavanderia";
 #define PIN_SWITCH  27
 #define DEBOUNCE_MS 50
 
+#define TZ_INFO     "<-03>3"   // Brasília, sem horário de verão
+#define NTP_SERVER1 "pool.ntp.org"
+#define NTP_SERVER2 "a.st1.ntp.br"
+
+// O PubSubClient espera o CONNACK (e cada byte lido) em laço ocupado até
+// esse limite, sem alimentar o watchdog. O nome do broker é resolvido
+// fora do connect (HostResolver), que recebe o IP: sobra o connect TCP
+// (3 s no WiFiClient) mais esse limite, abaixo de STALL_WDT_TIMEOUT_S.
+#define MQTT_SOCKET_TIMEOUT_S 4
+#define MQTT_TCP_TIMEOUT_S    3
+static_assert(MQTT_TCP_TIMEOUT_S + MQTT_SOCKET_TIMEOUT_S < STALL_WDT_TIMEOUT_S,
+              "connect MQTT pode disparar o watchdog");
+
+// Cada tentativa falha pode travar o loop pelo tempo acima: espera entre
+// tentativas dobra até o máximo (zera ao conectar ou trocar de broker)
+#define MQTT_RETRY_MIN_MS 2000
+#define MQTT_RETRY_MAX_MS 30000
+
+// Ecos das nossas publicações retidas (assinamos o mesmo tópico): chegam
+// na ordem em que saíram e não são comandos
+#define MQTT_ECHO_MAX    4
+#define MQTT_ECHO_TTL_MS 5000
+
 // =========================
 // GLOBAL STATE
 // =========================
-volatile int lampState = 0;   // 0=off, 1=on
+// O estado da lâmpada é do CommandBus; ninguém mais escreve nele
 unsigned long lastDebounce = 0;
 int lastStableState = HIGH;
 int lastReading = HIGH;
 
+struct MqttEcho {
+    char     value;
+    uint32_t at;
+};
+MqttEcho mqttEchoes[MQTT_ECHO_MAX];
+uint8_t  mqttEchoHead = 0;
+uint8_t  mqttEchoCount = 0;
+
+uint32_t mqttRetryMs = 0;     // 0 = tenta já
+uint32_t mqttLastTry = 0;
+
 // =========================
 // OBJECTS
 // =========================
+Config       config;
+CommandBus   bus;
+WifiManager  wifi;
+UsageMeter   usage;
 WiFiClient   espClient;
 PubSubClient mqtt(espClient);
+HostResolver mqttDns;
 WebServer    server(80);
 WebPage      page(&server);
 
 // =========================
 // FORWARD DECLARATIONS
 // =========================
-void connectWiFiWithFallback();
-void startFallbackAP();
-
-void syncRelay();
 void publishState();
-void toggleLamp();
+void applyConfig(const ConfigData& before);
+void updateNetworkInfo();
 
 // =========================
-// TOGGLE LAMP (WEB + MQTT + FÍSICO)
+// MQTT CALLBACK
 // =========================
-void toggleLamp() {
-    lampState = !lampState;
-    syncRelay();
-
-    // Só publica no MQTT se estiver conectado
-    if (WiFi.getMode() == WIFI_MODE_STA &&
-        WiFi.status() == WL_CONNECTED &&
-        mqtt.connected()) {
-        publishState();
-    }
+static void popEcho() {
+    mqttEchoHead = (mqttEchoHead + 1) % MQTT_ECHO_MAX;
+    mqttEchoCount--;
+}
+
+static bool isOwnEcho(char value) {
+    // Eco que não voltou a tempo (queda, reconexão) não conta mais
+    while (mqttEchoCount && millis() - mqttEchoes[mqttEchoHead].at > MQTT_ECHO_TTL_MS) popEcho();
 
-    page.setStatus(lampState);
-    Serial.println("[ACTION] Toggle -> estado = " + String(lampState));
+    if (!mqttEchoCount || mqttEchoes[mqttEchoHead].value != value) return false;
+    popEcho();
+    return true;
 }
 
-// =========================
-// MQTT CALLBACK
-// =========================
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
+    HEAP_SCOPE("mqtt");
+
     String msg;
     for (unsigned int i = 0; i < length; i++) {
         msg += (char)payload[i];
     }
     msg.trim();
 
-    if (msg == "0")      lampState = 0;
-    else if (msg == "1") lampState = 1;
+    if (msg != "0" && msg != "1") {
+        LOGW("MQTT", "Payload ignorado: %s", msg.c_str());
+        return;
+    }
 
-    syncRelay();
-    page.setStatus(lampState);
+    // Sem isso, o eco atrasado de um estado antigo desfaria um toggle recente
+    if (isOwnEcho(msg[0])) {
+        LOGD("MQTT", "Eco ignorado: %s", msg.c_str());
+        return;
+    }
 
-    Serial.println("[MQTT] Novo estado recebido: " + msg);
+    bus.set(msg == "1", SRC_MQTT);
+    LOGI("MQTT", "Novo estado recebido: %s", msg.c_str());
 }
 
 // =========================
-// WIFI CONNECT OR FALLBACK AP
+// REDE (STA OU AP)
 // =========================
-bool tryConnectWiFi(String ssid, String pass, uint16_t timeoutSec) {
-    Serial.println("[WiFi] Tentando conectar em: " + ssid);
-
-    WiFi.setHostname(HOSTNAME);
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(ssid.c_str(), pass.c_str());
-
-    uint32_t start = millis();
-    while (WiFi.status() != WL_CONNECTED &&
-           (millis() - start) < (timeoutSec * 1000UL)) {
-        delay(300);
-        Serial.print(".");
-    }
-    Serial.println();
-
-    bool ok = (WiFi.status() == WL_CONNECTED);
-    Serial.println(ok ? "[WiFi] STA conectado." : "[WiFi] STA falhou.");
-    return ok;
+// Chamado pelo WifiManager a cada conexão, roaming ou ida para o AP
+void updateNetworkInfo() {
+    IPAddress ip = wifi.connected() ? WiFi.localIP() : WiFi.softAPIP();
+    LOGI("WEB", "IP para UI: %s", ip.toString().c_str());
+    page.setNetworkInfo(ip, WiFi.macAddress());
 }
 
-void startFallbackAP() {
-    Serial.println("\n[WiFi] Falha ao conectar. Iniciando AP...");
-    WiFi.mode(WIFI_AP);
-
-    const char* AP_SSID = "lampada_lavanderia";
-    const char* AP_PASS = "12345678";
+// =========================
+// STATE HELPERS
+// =========================
+static void cborTopic(char* out, size_t cap, const char* topic) {
+    snprintf(out, cap, "%s/cbor", topic);
+}
 
-    bool ok = WiFi.softAP(AP_SSID, AP_PASS);
-    if (!ok) {
-        Serial.println("[AP] Falha ao iniciar AP!");
-    } else {
-        Serial.println("[AP] AP ativo!");
-        Serial.println("SSID: lampada_lavanderia");
-        Serial.println("Senha: 12345678");
-        Serial.print("IP AP: ");
-        Serial.println(WiFi.softAPIP());
+// Opcional (mqttCbor): {on, seq, src, t} retido em <topic>/cbor, para
+// integrações que querem a origem e o seq da transição. O tópico de
+// comando continua "0"/"1"; este não é assinado.
+static void publishStateCbor() {
+    const Transition& t = bus.last();
+    char topic[sizeof(ConfigData::topic) + 5];
+    cborTopic(topic, sizeof(topic), config.get().topic);
+
+    uint8_t buf[48];
+    CborWriter w(buf, sizeof(buf));
+    w.map(4);
+    w.key("on");  w.boolean(bus.state());
+    w.key("seq"); w.uinteger(t.seq);
+    w.key("src"); w.text(CommandBus::sourceName(t.source));
+    w.key("t");   w.uinteger((uint32_t)time(nullptr));
+
+    if (w.overflow() || !mqtt.publish(topic, w.data(), w.length(), true)) {
+        LOGW("MQTT", "Falha ao publicar estado CBOR");
     }
+}
 
-    // Se quiser scan depois, faça assíncrono:
-    // WiFi.scanNetworks(true);
+// Retido vazio apaga o último estado CBOR desse tópico no broker
+static void clearStateCbor(const char* baseTopic) {
+    char topic[sizeof(ConfigData::topic) + 5];
+    cborTopic(topic, sizeof(topic), baseTopic);
+    mqtt.publish(topic, (const uint8_t*)"", 0, true);
 }
 
-void connectWiFiWithFallback() {
-    Preferences prefs;
-    prefs.begin("wifi");
+void publishState() {
+    bool on = bus.state();
+    if (!mqtt.publish(config.get().topic, on ? "1" : "0", true)) return;
 
-    String ssid = prefs.getString("ssid", WIFI_SSID);
-    String pass = prefs.getString("pass", WIFI_PASS);
+    if (mqttEchoCount == MQTT_ECHO_MAX) popEcho();
+    mqttEchoes[(mqttEchoHead + mqttEchoCount++) % MQTT_ECHO_MAX] = {on ? '1' : '0', millis()};
+    LOGI("MQTT", "Publicado estado: %d", on);
 
-    prefs.end();
+    if (config.get().mqttCbor) publishStateCbor();
+}
 
-    if (tryConnectWiFi(ssid, pass, 12)) {
-        Serial.print("[WiFi] Conectado! IP: ");
-        Serial.println(WiFi.localIP());
+// =========================
+// CONEXÃO MQTT
+// =========================
+static void mqttBackoff() {
+    if (!mqttRetryMs) mqttRetryMs = MQTT_RETRY_MIN_MS;
+    else if (mqttRetryMs < MQTT_RETRY_MAX_MS / 2) mqttRetryMs *= 2;
+    else mqttRetryMs = MQTT_RETRY_MAX_MS;
+    mqttLastTry = millis();
+}
+
+// Uma tentativa por chamada; com o DNS ainda no ar só volta no próximo loop
+void connectMqtt() {
+    DnsResult dns = mqttDns.resolve();
+    if (dns == DNS_PENDING) return;
+    if (dns == DNS_FAILED) {
+        mqttBackoff();
         return;
     }
 
-    startFallbackAP();
+    mqtt.setServer(mqttDns.ip(), config.get().mqttPort);
+    if (mqtt.connect(config.get().hostname)) {
+        LOGI("MQTT", "Conectado.");
+        mqttRetryMs = 0;
+        // publica estado inicial; ecos da conexão anterior não valem
+        mqttEchoCount = 0;
+        publishState();
+        mqtt.subscribe(config.get().topic);
+        return;
+    }
+
+    // O IP pode ter mudado: a próxima tentativa consulta de novo (o cache
+    // do lwIP responde na hora enquanto o TTL valer)
+    mqttDns.refresh();
+    mqttBackoff();
+    LOGW("MQTT", "Falha ao conectar (%d), nova tentativa em %lu s", mqtt.state(),
+         (unsigned long)(mqttRetryMs / 1000));
 }
 
 // =========================
-// STATE HELPERS
+// CONFIG AO VIVO
 // =========================
-void syncRelay() {
-    digitalWrite(PIN_RELAY, lampState ? HIGH : LOW);
-}
+// MQTT (host, porta, tópico, modo CBOR) e a lista de redes valem na
+// hora; o hostname fica para o próximo boot (a WebPage agenda o restart).
+void applyConfig(const ConfigData& before) {
+    const ConfigData& cfg = config.get();
 
-void publishState() {
-    mqtt.publish(TOPIC, lampState ? "1" : "0", true);
-    Serial.println("[MQTT] Publicado estado: " + String(lampState));
+    bool serverChanged = strcmp(before.mqttHost, cfg.mqttHost) != 0 ||
+                         before.mqttPort != cfg.mqttPort;
+    bool topicChanged  = strcmp(before.topic, cfg.topic) != 0;
+
+    Stall.setBudget(cfg.loopBudgetMs);
+
+    if (memcmp(before.nets, cfg.nets, sizeof(cfg.nets)) != 0) wifi.networksChanged();
+
+    // O CBOR retido no tópico antigo sai antes de qualquer troca (ainda no
+    // broker antigo): modo desligado ou tópico novo, junto ou não com o broker
+    bool cborChanged = before.mqttCbor != cfg.mqttCbor;
+    if (before.mqttCbor && (!cfg.mqttCbor || topicChanged) && mqtt.connected()) {
+        clearStateCbor(before.topic);
+    }
+
+    if (serverChanged) {
+        // O loop reconecta no novo broker, assina o tópico atual e publica
+        // o estado (e o CBOR, se ligado)
+        mqtt.disconnect();
+        mqttDns.setHost(cfg.mqttHost);
+        mqttRetryMs = 0;
+        LOGI("CFG", "MQTT -> %s:%u", cfg.mqttHost, (unsigned)cfg.mqttPort);
+    } else if (topicChanged && mqtt.connected()) {
+        mqtt.unsubscribe(before.topic);
+        publishState();
+        mqtt.subscribe(cfg.topic);
+        LOGI("CFG", "Tópico -> %s", cfg.topic);
+    } else if (cborChanged && cfg.mqttCbor && mqtt.connected()) {
+        publishStateCbor();
+    }
+
+    if (cborChanged) LOGI("CFG", "Estado CBOR %s", cfg.mqttCbor ? "ligado" : "desligado");
 }
 
 // =========================
@@ -169,70 +266,96 @@ void publishState() {
 // =========================
 void setup() {
     Serial.begin(115200);
+    Log.begin();
     delay(5000);
-    Serial.println("\n=== Boot Lâmpada Lavanderia ===");
+    LOGI("BOOT", "=== Boot Lâmpada Lavanderia ===");
+
+    config.begin();
+    config.onChange(applyConfig);
+    usage.begin();
 
     pinMode(PIN_RELAY,  OUTPUT);
     pinMode(PIN_LED,    OUTPUT);
     pinMode(PIN_SWITCH, INPUT_PULLUP);
 
     digitalWrite(PIN_LED, LOW);
-    syncRelay();
-
-    // ======= WIFI (STA + FALLBACK AP) =======
-    connectWiFiWithFallback();
+    digitalWrite(PIN_RELAY, LOW);
+
+    // ======= ESTADO (um dono; observadores na ordem de registro) =======
+    bus.observe([](const Transition& t) { digitalWrite(PIN_RELAY, t.on ? HIGH : LOW); });
+    bus.observe([](const Transition& t) { usage.record(t.on); });
+    bus.observe([](const Transition& t) {
+        if (wifi.connected() && mqtt.connected()) publishState();
+    });
+    bus.observe([](const Transition& t) { page.setStatus(t); });
+    bus.observe([](const Transition& t) {
+        LOGI("ACTION", "#%lu %s -> estado = %d", (unsigned long)t.seq,
+             CommandBus::sourceName(t.source), t.on);
+    });
+
+    // ======= WIFI (REDES SALVAS + FALLBACK AP) =======
+    wifi.onChange(updateNetworkInfo);
+    wifi.begin(&config);
+
+    // SNTP segue tentando sozinho; até responder, o uso só vai para os totais
+    configTzTime(TZ_INFO, NTP_SERVER1, NTP_SERVER2);
 
     // ======= MQTT (sempre configura; só conecta em STA) =======
-    mqtt.setServer(MQTT_HOST, MQTT_PORT);
+    // O servidor (IP resolvido + porta) entra a cada tentativa no loop
+    mqttDns.setHost(config.get().mqttHost);
     mqtt.setCallback(mqttCallback);
+    mqtt.setSocketTimeout(MQTT_SOCKET_TIMEOUT_S);
 
     // ======= Web UI =======
-    IPAddress ip;
-    if (WiFi.getMode() == WIFI_MODE_AP || WiFi.status() != WL_CONNECTED) {
-        ip = WiFi.softAPIP();   // 192.168.4.1 normalmente
-    } else {
-        ip = WiFi.localIP();    // IP em modo STA
-    }
-
-    Serial.print("[WEB] IP para UI: ");
-    Serial.println(ip);
-
-    page.setNetworkInfo(ip, WiFi.macAddress());
-    page.onToggle(toggleLamp);
+    page.setConfig(&config);
+    page.setWifi(&wifi);
+    page.setUsage(&usage);
+    page.onToggle([]() { bus.toggle(SRC_WEB); });
     page.setupRoutes();
 
     server.begin();
-    Serial.println("[WEB] WebServer iniciado.");
+    LOGI("WEB", "WebServer iniciado.");
+
+    // Watchdog só depois do setup: a conexão Wi-Fi acima bloqueia de propósito
+    Stall.begin(config.get().loopBudgetMs);
 
     digitalWrite(PIN_LED, HIGH);
-    Serial.println("=== Setup concluído ===");
+    LOGI("BOOT", "=== Setup concluído ===");
 }
 
 // =========================
 // MAIN LOOP
 // =========================
 void loop() {
-    // MQTT só roda quando estiver em modo STA e conectado
-    if (WiFi.getMode() == WIFI_MODE_STA && WiFi.status() == WL_CONNECTED) {
-        if (!mqtt.connected()) {
-            if (mqtt.connect(HOSTNAME)) {
-                Serial.println("[MQTT] Conectado.");
-                // publica estado inicial
-                publishState();
-                mqtt.subscribe(TOPIC);
-            } else {
-                // não travar o loop com tentativas infinitas
-                static unsigned long lastRetry = 0;
-                if (millis() - lastRetry > 5000) {
-                    Serial.println("[MQTT] Falha ao conectar, tentando novamente...");
-                    lastRetry = millis();
-                }
-            }
+    Stall.loopBegin();
+
+    {
+        STALL_PHASE("wifi");
+        wifi.loop();
+    }
+
+    // MQTT só roda quando o STA estiver conectado
+    if (wifi.connected()) {
+        if (!mqtt.connected() && millis() - mqttLastTry >= mqttRetryMs) {
+            STALL_PHASE("mqtt.connect");
+            connectMqtt();
         }
+        STALL_PHASE("mqtt");
         mqtt.loop();
+    } else {
+        mqttRetryMs = 0;   // Wi-Fi de volta: tenta o broker na hora
+    }
+
+    {
+        STALL_PHASE("http");
+        server.handleClient();
     }
+    page.loop();
 
-    server.handleClient();
+    {
+        STALL_PHASE("usage");
+        usage.loop();
+    }
 
     // ======= BOTÃO FÍSICO S2 =======
     int reading = digitalRead(PIN_SWITCH);
@@ -245,14 +368,20 @@ void loop() {
         if (reading != lastStableState) {
             // Chegou em um novo estado ESTÁVEL (aberto OU fechado)
             // → qualquer mudança de estado dispara toggle
-            toggleLamp();
+            bus.toggle(SRC_SWITCH);
 
-            Serial.print("[S2] Mudança de estado: ");
-            Serial.println(reading == LOW ? "FECHADO" : "ABERTO");
+            LOGI("S2", "Mudança de estado: %s", reading == LOW ? "FECHADO" : "ABERTO");
 
             lastStableState = reading;
         }
     }
 
     lastReading = reading;
+
+    {
+        STALL_PHASE("bus");
+        bus.loop();
+    }
+
+    Stall.loopEnd();
 }
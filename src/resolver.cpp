@@ -0,0 +1,60 @@
+#include "resolver.h"
+#include "log.h"
+
+// Endereço IPv4 do lwIP (ordem de rede) para IPAddress
+static IPAddress toIp(uint32_t v) {
+    return IPAddress(v & 0xFF, v >> 8 & 0xFF, v >> 16 & 0xFF, v >> 24 & 0xFF);
+}
+
+void HostResolver::setHost(const char* host) {
+    strncpy(_host, host, sizeof(_host) - 1);
+    _host[sizeof(_host) - 1] = '\0';
+    _valid = false;
+    if (_pending) _stale = true;
+}
+
+// Roda na task do lwIP: só entrega a resposta, o loop a consome
+void HostResolver::found(const char* name, const ip_addr_t* addr, void* arg) {
+    HostResolver* self = static_cast<HostResolver*>(arg);
+    self->_answer.store(addr ? ip4_addr_get_u32(ip_2_ip4(addr)) : 0, std::memory_order_relaxed);
+    self->_answered.store(true, std::memory_order_release);
+}
+
+DnsResult HostResolver::resolve() {
+    if (_answered.load(std::memory_order_acquire)) {
+        uint32_t answer = _answer.load(std::memory_order_relaxed);
+        _answered = false;
+        _pending = false;
+
+        if (_stale) {
+            _stale = false;            // resposta do nome anterior
+        } else if (answer) {
+            _ip = toIp(answer);
+            _valid = true;
+            LOGI("DNS", "%s -> %s", _host, _ip.toString().c_str());
+        } else {
+            LOGW("DNS", "Falha ao resolver %s", _host);
+            return DNS_FAILED;
+        }
+    }
+
+    if (_valid) return DNS_OK;
+    if (_pending) return DNS_PENDING;
+
+    // Antes da chamada: o callback pode vir antes de ela retornar
+    _pending = true;
+    ip_addr_t addr;
+    err_t err = dns_gethostbyname(_host, &addr, found, this);
+
+    if (err == ERR_INPROGRESS) return DNS_PENDING;
+
+    _pending = false;
+    if (err == ERR_OK) {
+        _ip = toIp(ip4_addr_get_u32(ip_2_ip4(&addr)));
+        _valid = true;
+        return DNS_OK;
+    }
+
+    LOGW("DNS", "Consulta de %s recusada (%d)", _host, (int)err);
+    return DNS_FAILED;
+}
@@ -0,0 +1,51 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <lwip/dns.h>
+#include <atomic>
+
+// =========================
+// RESOLUÇÃO DNS SEM BLOQUEIO
+// =========================
+// O WiFiClient::connect(host) resolve o nome com hostByName(), que espera
+// a resposta do DNS (até ~15 s com o servidor mudo) sem alimentar o
+// watchdog. Aqui a consulta vai para o lwIP com callback e o loop só
+// pergunta se já terminou; o connect recebe o IP pronto. IP literal e nome
+// no cache do lwIP (dentro do TTL) resolvem na hora.
+
+enum DnsResult {
+    DNS_PENDING,   // consulta em andamento
+    DNS_OK,        // ip() vale
+    DNS_FAILED,    // sem resposta ou nome inexistente
+};
+
+class HostResolver {
+public:
+    // Troca o nome: esquece o IP e descarta a resposta de consulta antiga
+    void setHost(const char* host);
+    const char* host() const { return _host; }
+
+    // Não bloqueia; sem IP, dispara (ou acompanha) a consulta
+    DnsResult resolve();
+    IPAddress ip() const { return _ip; }
+
+    // Próximo resolve() consulta de novo (ex.: connect falhou)
+    void refresh() { _valid = false; }
+
+private:
+    static void found(const char* name, const ip_addr_t* addr, void* arg);
+
+    char      _host[64] = "";
+    IPAddress _ip;
+    bool      _valid = false;
+    bool      _stale = false;                 // host trocado com consulta no ar
+
+    // Escritos pelo callback (task do lwIP)
+    std::atomic<bool>     _pending{false};
+    std::atomic<bool>     _answered{false};
+    std::atomic<uint32_t> _answer{0};         // 0 = falhou
+};
+
+#endif
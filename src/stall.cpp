@@ -0,0 +1,141 @@
+#include "stall.h"
+#include "log.h"
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_task_wdt.h>
+
+StallMonitor Stall;
+
+// Fase em andamento, fora do .bss: sobrevive a reset por watchdog/panic
+#define CRUMB_MAGIC 0x5354414C   // "STAL"
+
+struct Crumb {
+    uint32_t magic;
+    char     phase[STALL_NAME_MAX];
+};
+
+static __NOINIT_ATTR Crumb s_crumb;
+
+static void dropCrumb(const char* phase) {
+    strncpy(s_crumb.phase, phase, STALL_NAME_MAX - 1);
+    s_crumb.phase[STALL_NAME_MAX - 1] = '\0';
+}
+
+static const char* watchdogReason(esp_reset_reason_t r) {
+    switch (r) {
+        case ESP_RST_TASK_WDT: return "task_wdt";
+        case ESP_RST_INT_WDT:  return "int_wdt";
+        case ESP_RST_WDT:      return "wdt";
+        case ESP_RST_PANIC:    return "panic";
+        default:               return nullptr;
+    }
+}
+
+void StallMonitor::begin(uint32_t budgetMs, uint32_t wdtTimeoutSec) {
+    setBudget(budgetMs);
+
+    const char* reason = watchdogReason(esp_reset_reason());
+    if (reason && s_crumb.magic == CRUMB_MAGIC) {
+        _resetReason = reason;
+        memcpy(_resetPhase, s_crumb.phase, STALL_NAME_MAX);
+        _resetPhase[STALL_NAME_MAX - 1] = '\0';
+        LOGW("STALL", "Reset por %s durante a fase %s", _resetReason, _resetPhase);
+    }
+    s_crumb.magic = CRUMB_MAGIC;
+    dropCrumb("setup");
+
+    // Com panic=true o watchdog reinicia a placa em vez de só avisar
+    esp_task_wdt_init(wdtTimeoutSec, true);
+    enableLoopWDT();
+}
+
+StallPhaseStats* StallMonitor::acquire(const char* name) {
+    for (size_t i = 0; i < _count; i++) {
+        if (_stats[i].name == name || strcmp(_stats[i].name, name) == 0) return &_stats[i];
+    }
+    if (_count == STALL_MAX_PHASES) return nullptr;
+
+    StallPhaseStats& s = _stats[_count++];
+    memset(&s, 0, sizeof(s));
+    s.name = name;
+    return &s;
+}
+
+void StallMonitor::reset() {
+    _count = 0;
+    _stalls = 0;
+    _worstLoopUs = 0;
+}
+
+// =========================
+// LOOP
+// =========================
+void StallMonitor::loopBegin() {
+    _loops++;
+    _loopStart = micros();
+    _iterWorst = nullptr;
+    _iterWorstUs = 0;
+    dropCrumb("loop");
+}
+
+void StallMonitor::loopEnd() {
+    uint32_t elapsed = micros() - _loopStart;
+    if (elapsed > _worstLoopUs) _worstLoopUs = elapsed;
+    if (elapsed <= _budgetUs) return;
+
+    _stalls++;
+
+    // Sem fase que explique o tempo, o culpado é o código fora de fases
+    const char* name = _iterWorst ? _iterWorst : "loop";
+    LOGW("STALL", "Loop levou %lu ms (orçamento %lu ms), fase %s",
+         (unsigned long)(elapsed / 1000), (unsigned long)(_budgetUs / 1000), name);
+
+    StallPhaseStats* s = acquire(name);
+    if (!s) return;
+
+    s->stalls++;
+    s->totalMs += elapsed / 1000;
+    s->lastAt = millis();
+    if (elapsed / 1000 >= s->worstMs) {
+        s->worstMs = elapsed / 1000;
+        s->worstPhaseMs = _iterWorstUs / 1000;
+    }
+}
+
+// O WebServer lê o upload inteiro dentro de um handleClient(): sem isso,
+// um OTA de mais de STALL_WDT_TIMEOUT_S reiniciaria a placa no meio
+void StallMonitor::feed() {
+    esp_task_wdt_reset();
+}
+
+// =========================
+// FASES
+// =========================
+void StallMonitor::enter(const char* phase) {
+    if (_depth < STALL_MAX_DEPTH) {
+        Frame& f = _stack[_depth];
+        f.name = phase;
+        f.start = micros();
+        f.childUs = 0;
+    }
+    _depth++;
+    dropCrumb(phase);
+}
+
+void StallMonitor::exit() {
+    if (_depth == 0) return;
+    _depth--;
+    if (_depth >= STALL_MAX_DEPTH) return;
+
+    Frame& f = _stack[_depth];
+    uint32_t elapsed = micros() - f.start;
+    uint32_t self = elapsed > f.childUs ? elapsed - f.childUs : 0;
+
+    if (_depth) _stack[_depth - 1].childUs += elapsed;
+    dropCrumb(_depth ? _stack[_depth - 1].name : "loop");
+
+    if (self > _iterWorstUs) {
+        _iterWorst = f.name;
+        _iterWorstUs = self;
+    }
+}
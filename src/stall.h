@@ -0,0 +1,93 @@
+#ifndef STALL_H
+#define STALL_H
+
+#include <Arduino.h>
+
+// =========================
+// DETECTOR DE TRAVAMENTO DO LOOP
+// =========================
+// Cada iteração do loop é cronometrada; trechos marcados com
+// STALL_PHASE(nome) (MQTT, rota HTTP, OTA, Wi-Fi...) medem o próprio tempo
+// (descontando fases internas). Se a iteração passa do orçamento, o
+// travamento é atribuído à fase mais lenta (por nome: sem backtrace, que
+// só sairia depois de a fase acabar). O task watchdog reinicia a placa se
+// o loop parar de vez, e a fase em andamento sobrevive ao reset para ser
+// reportada no boot.
+
+#define STALL_MAX_PHASES    16
+#define STALL_MAX_DEPTH     4
+#define STALL_NAME_MAX      24
+#define STALL_WDT_TIMEOUT_S 10
+
+struct StallPhaseStats {
+    const char* name;
+    uint32_t stalls;
+    uint32_t totalMs;       // soma das iterações travadas
+    uint32_t worstMs;       // pior iteração
+    uint32_t worstPhaseMs;  // tempo próprio da fase na pior iteração
+    uint32_t lastAt;        // millis() do último travamento
+};
+
+class StallMonitor {
+public:
+    void begin(uint32_t budgetMs, uint32_t wdtTimeoutSec = STALL_WDT_TIMEOUT_S);
+    void setBudget(uint32_t budgetMs) { _budgetUs = budgetMs * 1000UL; }
+
+    void loopBegin();
+    void loopEnd();
+    // Alimenta o watchdog de dentro de uma iteração longa legítima (OTA)
+    void feed();
+    void enter(const char* phase);
+    void exit();
+
+    uint32_t budgetMs() const { return _budgetUs / 1000; }
+    uint32_t loops() const { return _loops; }
+    uint32_t stalls() const { return _stalls; }
+    uint32_t worstLoopMs() const { return _worstLoopUs / 1000; }
+    const char* resetReason() const { return _resetReason; }
+    const char* resetPhase() const { return _resetPhase; }
+
+    size_t count() const { return _count; }
+    const StallPhaseStats& at(size_t i) const { return _stats[i]; }
+    void reset();
+
+private:
+    struct Frame {
+        const char* name;
+        uint32_t start;
+        uint32_t childUs;
+    };
+
+    uint32_t _budgetUs = 100000;
+    uint32_t _loopStart = 0;
+    uint32_t _loops = 0;
+    uint32_t _stalls = 0;
+    uint32_t _worstLoopUs = 0;
+
+    Frame   _stack[STALL_MAX_DEPTH];
+    uint8_t _depth = 0;
+
+    // Fase mais lenta da iteração atual
+    const char* _iterWorst = nullptr;
+    uint32_t    _iterWorstUs = 0;
+
+    StallPhaseStats _stats[STALL_MAX_PHASES];
+    size_t _count = 0;
+
+    const char* _resetReason = nullptr;
+    char _resetPhase[STALL_NAME_MAX] = "";
+
+    StallPhaseStats* acquire(const char* name);
+};
+
+extern StallMonitor Stall;
+
+class StallPhase {
+public:
+    explicit StallPhase(const char* name) { Stall.enter(name); }
+    ~StallPhase() { Stall.exit(); }
+};
+
+#define STALL_PHASE(name) StallPhase _stallPhase(name)
+
+#endif
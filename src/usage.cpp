@@ -0,0 +1,228 @@
+#include "usage.h"
+#include "config.h"
+#include "log.h"
+#include <Preferences.h>
+
+static const char* USAGE_NS  = "usage";
+static const char* USAGE_KEY = "bins";
+
+#define USAGE_MAGIC   0x55534745   // "USGE"
+#define USAGE_VERSION 1
+#define TIME_VALID    1700000000   // antes disso o SNTP ainda não respondeu
+
+struct UsageHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+};
+
+// =========================
+// CALENDÁRIO
+// =========================
+// Dias desde 1970-01-01 (algoritmo de Howard Hinnant) e o inverso
+static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+static void civilFromDays(int32_t z, int32_t& y, uint32_t& m, uint32_t& d) {
+    z += 719468;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int32_t)yoe + era * 400 + (m <= 2);
+}
+
+bool UsageMeter::synced() const {
+    return time(nullptr) > TIME_VALID;
+}
+
+bool UsageMeter::currentKeys(Keys& k) const {
+    time_t now = time(nullptr);
+    if (now <= TIME_VALID) return false;
+
+    struct tm t;
+    localtime_r(&now, &t);
+    int32_t day = daysFromCivil(t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+    k.day   = (uint32_t)day;
+    k.hour  = (uint32_t)day * 24 + t.tm_hour;
+    k.month = (uint32_t)(t.tm_year + 1900) * 12 + t.tm_mon;
+    return true;
+}
+
+uint32_t UsageMeter::currentKey(UsagePeriod p) const {
+    Keys k;
+    if (!currentKeys(k)) return 0;
+    return p == USAGE_HOUR ? k.hour : p == USAGE_DAY ? k.day : k.month;
+}
+
+void UsageMeter::label(UsagePeriod p, uint32_t key, char* buf, size_t cap) {
+    int32_t y;
+    uint32_t m, d;
+
+    if (p == USAGE_MONTH) {
+        snprintf(buf, cap, "%04ld-%02lu", (long)(key / 12), (unsigned long)(key % 12 + 1));
+        return;
+    }
+
+    civilFromDays(p == USAGE_HOUR ? key / 24 : key, y, m, d);
+    if (p == USAGE_HOUR) {
+        snprintf(buf, cap, "%04ld-%02lu-%02lu %02lu", (long)y, (unsigned long)m,
+                 (unsigned long)d, (unsigned long)(key % 24));
+    } else {
+        snprintf(buf, cap, "%04ld-%02lu-%02lu", (long)y, (unsigned long)m, (unsigned long)d);
+    }
+}
+
+// =========================
+// BINS
+// =========================
+size_t UsageMeter::capacity(UsagePeriod p) {
+    return p == USAGE_HOUR ? USAGE_HOURS : p == USAGE_DAY ? USAGE_DAYS : USAGE_MONTHS;
+}
+
+UsageBin* UsageMeter::slots(UsagePeriod p) {
+    return p == USAGE_HOUR ? _d.hours : p == USAGE_DAY ? _d.days : _d.months;
+}
+
+const UsageBin* UsageMeter::slots(UsagePeriod p) const {
+    return p == USAGE_HOUR ? _d.hours : p == USAGE_DAY ? _d.days : _d.months;
+}
+
+const UsageBin* UsageMeter::bin(UsagePeriod p, uint32_t ago) const {
+    uint32_t key = currentKey(p);
+    if (!key || ago >= capacity(p) || ago >= key) return nullptr;
+
+    key -= ago;
+    const UsageBin& b = slots(p)[key % capacity(p)];
+    return b.key == key ? &b : nullptr;
+}
+
+static void bump(UsageBin* bins, size_t n, uint32_t key, uint32_t sec, uint32_t switches) {
+    UsageBin& b = bins[key % n];
+    if (b.key != key) {
+        b.key = key;
+        b.onSec = 0;
+        b.switches = 0;
+    }
+    b.onSec += sec;
+    b.switches += switches;
+}
+
+void UsageMeter::add(uint32_t sec, uint32_t switches) {
+    _d.totalOnSec += sec;
+    _d.totalSwitches += switches;
+
+    // O que ficou pendente antes do SNTP vai junto no primeiro bin válido
+    sec += _pendSec;
+    switches += _pendSwitches;
+    if (!sec && !switches) return;
+    _dirty = true;
+
+    Keys k;
+    if (!currentKeys(k)) {
+        _pendSec = sec;
+        _pendSwitches = switches;
+        return;
+    }
+    _pendSec = _pendSwitches = 0;
+    if (!_d.since) _d.since = time(nullptr);
+
+    bump(_d.hours,  USAGE_HOURS,  k.hour,  sec, switches);
+    bump(_d.days,   USAGE_DAYS,   k.day,   sec, switches);
+    bump(_d.months, USAGE_MONTHS, k.month, sec, switches);
+}
+
+// =========================
+// ACUMULADORES
+// =========================
+void UsageMeter::tick() {
+    uint32_t now = millis();
+    uint32_t elapsed = now - _lastTick;
+    _lastTick = now;
+
+    uint32_t sec = 0;
+    if (_on) {
+        _accMs += elapsed;
+        sec = _accMs / 1000;
+        _accMs %= 1000;
+    }
+
+    add(sec, 0);
+}
+
+void UsageMeter::record(bool on) {
+    if (on == _on) return;
+
+    tick();   // o tempo até aqui ainda é do estado anterior
+    _on = on;
+    if (on) add(0, 1);
+}
+
+void UsageMeter::loop() {
+    uint32_t now = millis();
+    if (now - _lastTick >= USAGE_TICK_MS) tick();
+    if (_dirty && now - _lastSave >= USAGE_SAVE_MS) save();
+}
+
+// =========================
+// PERSISTÊNCIA
+// =========================
+void UsageMeter::begin() {
+    memset(&_d, 0, sizeof(_d));
+    _lastTick = _lastSave = millis();
+
+    Preferences prefs;
+    if (!prefs.begin(USAGE_NS, true)) return;
+
+    uint8_t buf[sizeof(UsageHeader) + sizeof(UsageData) + 4];
+    size_t len = prefs.getBytesLength(USAGE_KEY);
+    bool ok = len == sizeof(buf) && prefs.getBytes(USAGE_KEY, buf, len) == len;
+    prefs.end();
+
+    UsageHeader h;
+    uint32_t crc;
+    if (ok) {
+        memcpy(&h, buf, sizeof(h));
+        memcpy(&crc, buf + len - 4, 4);
+        ok = h.magic == USAGE_MAGIC && h.version == USAGE_VERSION &&
+             h.size == sizeof(UsageData) && blobCrc32(buf, len - 4) == crc;
+    }
+
+    if (!ok) {
+        LOGW("USAGE", "Sem histórico de uso válido, começando do zero");
+        return;
+    }
+
+    memcpy(&_d, buf + sizeof(h), sizeof(_d));
+    LOGI("USAGE", "Carregado: %lu s ligada, %lu acionamentos",
+         (unsigned long)_d.totalOnSec, (unsigned long)_d.totalSwitches);
+}
+
+void UsageMeter::save() {
+    _lastSave = millis();
+    if (!_dirty) return;
+
+    uint8_t buf[sizeof(UsageHeader) + sizeof(UsageData) + 4];
+    UsageHeader h = {USAGE_MAGIC, USAGE_VERSION, sizeof(UsageData)};
+    memcpy(buf, &h, sizeof(h));
+    memcpy(buf + sizeof(h), &_d, sizeof(_d));
+    uint32_t crc = blobCrc32(buf, sizeof(buf) - 4);
+    memcpy(buf + sizeof(buf) - 4, &crc, 4);
+
+    Preferences prefs;
+    bool ok = prefs.begin(USAGE_NS, false) &&
+              prefs.putBytes(USAGE_KEY, buf, sizeof(buf)) == sizeof(buf);
+    prefs.end();
+
+    if (ok) _dirty = false;
+    else    LOGE("USAGE", "Falha ao gravar histórico de uso");
+}
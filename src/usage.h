@@ -0,0 +1,85 @@
+#ifndef USAGE_H
+#define USAGE_H
+
+#include <Arduino.h>
+#include <time.h>
+
+// =========================
+// CONTABILIDADE DE USO
+// =========================
+// Tempo ligado e acionamentos (transições para ligado) acumulados em
+// tempo constante a cada mudança de estado e já agregados em bins fixos
+// por hora, dia e mês (hora local). Cada bin mora em slot = chave % N e
+// guarda a própria chave, então um slot de outro período é zerado ao ser
+// reaproveitado: não há histórico bruto para varrer. Antes do SNTP só os
+// totais andam; o acumulado entra no bin atual quando a hora chega.
+// Gravado na NVS a cada USAGE_SAVE_MS (um reset perde no máximo isso).
+
+#define USAGE_HOURS   48
+#define USAGE_DAYS    62
+#define USAGE_MONTHS  24
+#define USAGE_SAVE_MS (15UL * 60 * 1000)
+#define USAGE_TICK_MS 1000
+
+enum UsagePeriod {
+    USAGE_HOUR,
+    USAGE_DAY,
+    USAGE_MONTH,
+};
+
+struct UsageBin {
+    uint32_t key;        // hora/dia/mês absoluto; 0 = vazio
+    uint32_t onSec;
+    uint32_t switches;
+};
+
+struct UsageData {
+    uint32_t totalOnSec;
+    uint32_t totalSwitches;
+    uint32_t since;      // epoch da primeira contagem com hora válida
+    UsageBin hours[USAGE_HOURS];
+    UsageBin days[USAGE_DAYS];
+    UsageBin months[USAGE_MONTHS];
+};
+
+class UsageMeter {
+public:
+    void begin();
+    void record(bool on);   // a cada aplicação do estado; repetição é ignorada
+    void loop();
+    void save();            // grava já, se houver o que gravar
+
+    bool on() const { return _on; }
+    bool synced() const;
+    const UsageData& data() const { return _d; }
+
+    // Bin de `ago` períodos atrás (0 = atual); nullptr se vazio
+    const UsageBin* bin(UsagePeriod p, uint32_t ago) const;
+    static size_t capacity(UsagePeriod p);
+    static void label(UsagePeriod p, uint32_t key, char* buf, size_t cap);
+
+private:
+    struct Keys {
+        uint32_t hour;
+        uint32_t day;
+        uint32_t month;
+    };
+
+    UsageData _d;
+    bool      _on = false;
+    bool      _dirty = false;
+    uint32_t  _lastTick = 0;
+    uint32_t  _lastSave = 0;
+    uint32_t  _accMs = 0;       // fração de segundo ligado ainda não contada
+    uint32_t  _pendSec = 0;     // acumulado antes do SNTP
+    uint32_t  _pendSwitches = 0;
+
+    void tick();
+    void add(uint32_t sec, uint32_t switches);
+    bool currentKeys(Keys& k) const;
+    uint32_t currentKey(UsagePeriod p) const;
+    UsageBin* slots(UsagePeriod p);
+    const UsageBin* slots(UsagePeriod p) const;
+};
+
+#endif
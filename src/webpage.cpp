@@ -1,6 +1,12 @@
 #include "webpage.h"
+#include "log.h"
+#include "heaptrace.h"
+#include "stall.h"
 #include <Preferences.h>
 
+#define SCAN_FRESH_MS 10000   // /scan reaproveita o último scan até essa idade
+#define CBOR_CHUNK    256     // bloco de cada sendContent nas respostas CBOR
+
 WebPage::WebPage(WebServer* server) {
     _server = server;
 }
@@ -10,21 +16,206 @@ void WebPage::setNetworkInfo(IPAddress ip, String mac) {
     _mac = mac;
 }
 
-void WebPage::setStatus(bool lampOn) {
-    _lampOn = lampOn;
+void WebPage::setStatus(const Transition& t) {
+    _lampOn = t.on;
+    _seq = t.seq;
 
-    time_t now = time(nullptr);
-    char buffer[32];
-    strftime(buffer, sizeof(buffer), "%d/%m/%Y %H:%M:%S", localtime(&now));
+    _history[_historyHead] = {t, time(nullptr)};
+    _historyHead = (_historyHead + 1) % HISTORY_LEN;
+    if (_historyCount < HISTORY_LEN) _historyCount++;
+}
 
-    String linha = "🕒 " + String(buffer) + " → " + (_lampOn ? "Ligada" : "Desligada") + "<br>";
-    _historico = linha + _historico;
+// Mais recente primeiro, no mesmo formato de linha de antes
+String WebPage::historyHtml() {
+    String out;
+    out.reserve(_historyCount * 64);
+    for (size_t i = 0; i < _historyCount; i++) {
+        const HistoryEntry& e = _history[(_historyHead + HISTORY_LEN - 1 - i) % HISTORY_LEN];
+
+        char buffer[32];
+        strftime(buffer, sizeof(buffer), "%d/%m/%Y %H:%M:%S", localtime(&e.wall));
+
+        out += "🕒 ";
+        out += buffer;
+        out += e.t.on ? " → Ligada (" : " → Desligada (";
+        out += CommandBus::sourceName(e.t.source);
+        out += ")<br>";
+    }
+    return out;
 }
 
 void WebPage::onToggle(std::function<void(void)> cb) {
     _callback = cb;
 }
 
+void WebPage::setConfig(Config* config) {
+    _config = config;
+}
+
+void WebPage::setWifi(WifiManager* wifi) {
+    _wifi = wifi;
+}
+
+void WebPage::setUsage(UsageMeter* usage) {
+    _usage = usage;
+}
+
+// Restart adiado: a resposta HTTP sai e o loop segue rodando até lá,
+// em vez de travar num delay() dentro do handler.
+void WebPage::scheduleRestart(uint32_t delayMs) {
+    _restartAt = millis() + delayMs;
+    if (_restartAt == 0) _restartAt = 1;
+}
+
+void WebPage::loop() {
+    if (_restartAt && (int32_t)(millis() - _restartAt) >= 0) {
+        _restartAt = 0;
+        if (_usage) _usage->save();   // não perde o uso desde a última gravação
+        LOGI("WEB", "Reiniciando...");
+        ESP.restart();
+    }
+}
+
+static void appendJsonString(String& out, const char* s) {
+    out += '"';
+    for (; *s; s++) {
+        char c = *s;
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((uint8_t)c < 0x20) {
+            char esc[8];
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            out += esc;
+        }
+        else out += c;
+    }
+    out += '"';
+}
+
+void WebPage::sendConfigJson(int code, const char* error, bool restart) {
+    const ConfigData& c = _config->get();
+
+    String json = "{\"ok\":";
+    json += error ? "false" : "true";
+    if (error) {
+        json += ",\"error\":";
+        appendJsonString(json, error);
+    }
+    json += ",\"restart\":";
+    json += restart ? "true" : "false";
+    json += ",\"generation\":" + String((unsigned long)_config->generation());
+    json += ",\"networks\":[";
+    for (uint8_t i = 0; i < WIFI_MAX_NETS && c.nets[i].ssid[0]; i++) {
+        if (i) json += ",";
+        appendJsonString(json, c.nets[i].ssid);
+    }
+    json += "]";
+    json += ",\"mqttHost\":";
+    appendJsonString(json, c.mqttHost);
+    json += ",\"mqttPort\":" + String(c.mqttPort);
+    json += ",\"topic\":";
+    appendJsonString(json, c.topic);
+    json += ",\"hostname\":";
+    appendJsonString(json, c.hostname);
+    json += ",\"loopBudgetMs\":" + String(c.loopBudgetMs);
+    json += ",\"lampWatts\":" + String(c.lampWatts);
+    json += ",\"mqttCbor\":";
+    json += c.mqttCbor ? "true" : "false";
+    json += "}";
+
+    _server->send(code, "application/json", json);
+}
+
+void WebPage::sendWifiJson(int code, const char* error) {
+    const ConfigData& c = _config->get();
+
+    String json = "{\"ok\":";
+    json += error ? "false" : "true";
+    if (error) {
+        json += ",\"error\":";
+        appendJsonString(json, error);
+    }
+    json += ",\"connected\":";
+    json += _wifi->connected() ? "true" : "false";
+    json += ",\"ap\":";
+    json += _wifi->apMode() ? "true" : "false";
+    json += ",\"current\":" + String(_wifi->currentNet());
+    json += ",\"rssi\":" + String(_wifi->rssiAvg());
+    json += ",\"roams\":" + String((unsigned long)_wifi->roams());
+    json += ",\"networks\":[";
+    for (uint8_t i = 0; i < WIFI_MAX_NETS && c.nets[i].ssid[0]; i++) {
+        if (i) json += ",";
+        json += "{\"ssid\":";
+        appendJsonString(json, c.nets[i].ssid);
+        json += ",\"hasPass\":";
+        json += c.nets[i].pass[0] ? "true" : "false";
+        json += "}";
+    }
+    json += "]}";
+
+    _server->send(code, "application/json", json);
+}
+
+// kWh estimado pela potência configurada; sem potência, null
+static void formatKwh(char* out, size_t cap, uint32_t onSec, uint16_t watts) {
+    if (!watts) snprintf(out, cap, "null");
+    else        snprintf(out, cap, "%.3f", onSec * (double)watts / 3600000.0);
+}
+
+// Bins do mais recente ao mais antigo, em blocos de até 512 bytes
+void WebPage::sendUsageBins(const char* name, UsagePeriod period) {
+    uint16_t watts = _config->get().lampWatts;
+    char buf[512];
+    char t[20], kwh[16];
+
+    int n = snprintf(buf, sizeof(buf), ",\"%s\":[", name);
+    bool first = true;
+    for (uint32_t ago = 0; ago < UsageMeter::capacity(period); ago++) {
+        const UsageBin* b = _usage->bin(period, ago);
+        if (!b) continue;
+
+        UsageMeter::label(period, b->key, t, sizeof(t));
+        formatKwh(kwh, sizeof(kwh), b->onSec, watts);
+        n += snprintf(buf + n, sizeof(buf) - n,
+            "%s{\"t\":\"%s\",\"onSec\":%lu,\"switches\":%lu,\"kWh\":%s}",
+            first ? "" : ",", t, (unsigned long)b->onSec, (unsigned long)b->switches, kwh);
+        first = false;
+
+        if (n > (int)sizeof(buf) - 96) {
+            _server->sendContent(buf, n);
+            n = 0;
+        }
+    }
+    n += snprintf(buf + n, sizeof(buf) - n, "]");
+    _server->sendContent(buf, n);
+}
+
+// =========================
+// CBOR
+// =========================
+// Mesmos dados das rotas JSON, em tipos nativos (bool, inteiros, arrays)
+// e escritos direto no socket em blocos de CBOR_CHUNK, sem montar String.
+static void sendCborChunk(void* ctx, const uint8_t* data, size_t len) {
+    static_cast<WebServer*>(ctx)->sendContent((const char*)data, len);
+}
+
+// A resposta muda com o Accept: caches intermediários precisam saber
+bool WebPage::wantsCbor() {
+    _server->sendHeader("Vary", "Accept");
+    return _server->header("Accept").indexOf("application/cbor") >= 0 ||
+           _server->arg("fmt") == "cbor";
+}
+
+CborWriter WebPage::beginCbor(uint8_t* buf, size_t cap) {
+    _server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server->send(200, "application/cbor", "");
+    return CborWriter(buf, cap, sendCborChunk, _server);
+}
+
+void WebPage::endCbor(CborWriter& w) {
+    w.flush();
+    _server->sendContent("");
+}
+
 String WebPage::getWifiBars(int rssi) {
     if (rssi == 0) return "-----";
 
@@ -42,12 +233,50 @@ String WebPage::getWifiBars(int rssi) {
     return out;
 }
 
+// Todas as rotas passam por aqui para ganhar o escopo de diagnóstico
+void WebPage::route(const char* uri, WebServer::THandlerFunction fn) {
+    route(uri, HTTP_ANY, fn);
+}
+
+void WebPage::route(const char* uri, HTTPMethod method, WebServer::THandlerFunction fn) {
+#ifdef HEAP_TRACE
+    HeapTrace::declare(uri);   // orçamento definível antes do primeiro acesso
+#endif
+    _server->on(uri, method, [uri, fn]() {
+        HEAP_SCOPE(uri);
+        STALL_PHASE(uri);
+        fn();
+    });
+}
+
+void WebPage::route(const char* uri, HTTPMethod method,
+                    WebServer::THandlerFunction fn, WebServer::THandlerFunction ufn) {
+#ifdef HEAP_TRACE
+    HeapTrace::declare(uri);
+    HeapTrace::declare("/update (upload)");
+#endif
+    _server->on(uri, method,
+        [uri, fn]() {
+            HEAP_SCOPE(uri);
+            STALL_PHASE(uri);
+            fn();
+        },
+        [ufn]() {
+            HEAP_SCOPE("/update (upload)");
+            STALL_PHASE("ota");
+            ufn();
+        });
+}
+
 void WebPage::setupRoutes() {
+    // O WebServer só guarda os cabeçalhos pedidos aqui
+    static const char* headerKeys[] = {"Accept"};
+    _server->collectHeaders(headerKeys, 1);
 
     // ======================================================
     // PÁGINA PRINCIPAL
     // ======================================================
-    _server->on("/", [this]() {
+    route("/", [this]() {
         String html = R"rawliteral(
             <!DOCTYPE html>
             <html lang='pt-BR'>
@@ -149,6 +378,7 @@ void WebPage::setupRoutes() {
 
                     <div style="display:flex; flex-direction:column; gap:8px;">
                         <button class='btn btn-blue' onclick='openWifi()'>Trocar Wi-Fi</button>
+                        <button class='btn btn-blue' onclick='location.href="/config"'>Configurações</button>
                         <button class='btn btn-blue' onclick='openUpload()'>Atualizar</button>
                         <button class='btn btn-red' onclick='reboot()'>Reiniciar</button>
                     </div>
@@ -361,11 +591,11 @@ void WebPage::setupRoutes() {
                 fetch(`/setwifi?ssid=${selectedSSID}&pass=${pass}`)
                     .then(r => r.text())
                     .then(text => {
-                        msg.innerText = text + " Reiniciando...";
+                        msg.innerText = text;
 
                         setTimeout(() => {
                             location.reload();
-                        }, 3000);
+                        }, 5000);
                     });
             }
 
@@ -400,53 +630,299 @@ void WebPage::setupRoutes() {
     // ======================================================
     // STATUS JSON
     // ======================================================
-    _server->on("/status", [this]() {
+    // CBOR: {on, seq, history: [{seq, on, src, t, folded}]}, mais recente
+    // primeiro, com t em epoch (em vez do HTML de "historico")
+    route("/status", [this]() {
+        if (wantsCbor()) {
+            uint8_t buf[CBOR_CHUNK];
+            CborWriter w = beginCbor(buf, sizeof(buf));
+            w.map(3);
+            w.key("on");  w.boolean(_lampOn);
+            w.key("seq"); w.uinteger(_seq);
+            w.key("history");
+            w.array(_historyCount);
+            for (size_t i = 0; i < _historyCount; i++) {
+                const HistoryEntry& e = _history[(_historyHead + HISTORY_LEN - 1 - i) % HISTORY_LEN];
+                w.map(5);
+                w.key("seq");    w.uinteger(e.t.seq);
+                w.key("on");     w.boolean(e.t.on);
+                w.key("src");    w.text(CommandBus::sourceName(e.t.source));
+                w.key("t");      w.uinteger((uint32_t)e.wall);
+                w.key("folded"); w.uinteger(e.t.folded);
+            }
+            endCbor(w);
+            return;
+        }
+
         String json = "{\"on\":" + String(_lampOn ? 1 : 0) +
-                      ",\"historico\":\"" + _historico + "\"}";
+                      ",\"seq\":" + String((unsigned long)_seq) +
+                      ",\"historico\":\"" + historyHtml() + "\"}";
         _server->send(200, "application/json", json);
     });
 
     // ======================================================
     // ALTERAR ESTADO
     // ======================================================
-    _server->on("/toggle", HTTP_POST, [this]() {
+    route("/toggle", HTTP_POST, [this]() {
         if (_callback) _callback();
         _server->send(200, "text/plain", "ok");
     });
 
     // ======================================================
-    // LISTAR REDES Wi-Fi
+    // LOGS (tail do buffer circular)
     // ======================================================
-    _server->on("/scan", [this]() {
-        int n = WiFi.scanComplete();
-        if (n == WIFI_SCAN_RUNNING) {
-            _server->send(200, "application/json", "[]");
+    // GET /logs?since=<seq> → texto, uma linha por entrada.
+    // O cabeçalho X-Log-Next traz o próximo seq para o próximo poll.
+    route("/logs", [this]() {
+        uint32_t head  = Log.head();
+        uint32_t since = Log.oldest();
+        if (_server->hasArg("since")) {
+            uint32_t req = strtoul(_server->arg("since").c_str(), nullptr, 10);
+            if ((int32_t)(req - since) > 0) since = req;
+        }
+        if ((int32_t)(head - since) < 0) since = head;
+
+        char next[12];
+        snprintf(next, sizeof(next), "%lu", (unsigned long)head);
+        _server->sendHeader("X-Log-Next", next);
+        _server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _server->send(200, "text/plain; charset=utf-8", "");
+
+        LogEntry e;
+        char line[LOG_LINE_MAX + 32];
+        for (uint32_t seq = since; seq != head; seq++) {
+            if (!Log.read(seq, e)) continue;
+            size_t len = Logger::format(e, line, sizeof(line));
+            _server->sendContent(line, len);
+        }
+        _server->sendContent("");
+    });
+
+    // ======================================================
+    // DIAGNÓSTICO DE HEAP
+    // ======================================================
+    // GET /diag/heap                       → heap global (+ rotas com HEAP_TRACE)
+    // GET /diag/heap?route=/x&budget=8192  → define orçamento de pico da rota
+    // GET /diag/heap?reset=1               → zera os contadores das rotas
+    // Accept: application/cbor               → mesmo conteúdo em CBOR
+    route("/diag/heap", [this]() {
+#ifdef HEAP_TRACE
+        if (_server->hasArg("route") && _server->hasArg("budget")) {
+            // Todas as rotas já estão registradas desde o setupRoutes()
+            HeapScopeStats* s = HeapTrace::find(_server->arg("route").c_str());
+            if (!s) {
+                _server->send(404, "text/plain", "Rota desconhecida");
+                return;
+            }
+            HeapTrace::setBudget(s->name, strtoul(_server->arg("budget").c_str(), nullptr, 10));
+        }
+        if (_server->hasArg("reset")) HeapTrace::reset();
+#endif
+
+        if (wantsCbor()) {
+            uint8_t buf[CBOR_CHUNK];
+            CborWriter w = beginCbor(buf, sizeof(buf));
+            w.map(5);
+            w.key("free");    w.uinteger(ESP.getFreeHeap());
+            w.key("minFree"); w.uinteger(ESP.getMinFreeHeap());
+            w.key("largest"); w.uinteger(ESP.getMaxAllocHeap());
+#ifdef HEAP_TRACE
+            w.key("trace");   w.boolean(true);
+            w.key("routes");
+            w.array(HeapTrace::count());
+            for (size_t i = 0; i < HeapTrace::count(); i++) {
+                const HeapScopeStats& s = HeapTrace::at(i);
+                w.map(12);
+                w.key("name");          w.text(s.name);
+                w.key("calls");         w.uinteger(s.calls);
+                w.key("allocs");        w.uinteger(s.allocs);
+                w.key("bytes");         w.uinteger(s.bytes);
+                w.key("peak");          w.uinteger(s.peak);
+                w.key("lastPeak");      w.uinteger(s.lastPeak);
+                w.key("retained");      w.integer(s.lastRetained);
+                w.key("largestBefore"); w.uinteger(s.largestBefore);
+                w.key("largestAfter");  w.uinteger(s.largestAfter);
+                w.key("minLargest");    w.uinteger(s.calls ? s.minLargestAfter : 0);
+                w.key("budget");        w.uinteger(s.budget);
+                w.key("over");          w.uinteger(s.overBudget);
+            }
+#else
+            w.key("trace");   w.boolean(false);
+            w.key("routes");  w.array(0);
+#endif
+            endCbor(w);
             return;
         }
 
-        if (n < 0) {
-            WiFi.scanNetworks(true);
-            _server->send(200, "application/json", "[]");
+        char buf[256];
+        snprintf(buf, sizeof(buf),
+                 "{\"free\":%u,\"minFree\":%u,\"largest\":%u,\"trace\":%s,\"routes\":[",
+                 (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap(),
+                 (unsigned)ESP.getMaxAllocHeap(),
+#ifdef HEAP_TRACE
+                 "true"
+#else
+                 "false"
+#endif
+                 );
+
+        _server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _server->send(200, "application/json", buf);
+
+#ifdef HEAP_TRACE
+        for (size_t i = 0; i < HeapTrace::count(); i++) {
+            const HeapScopeStats& s = HeapTrace::at(i);
+            int n = snprintf(buf, sizeof(buf),
+                "%s{\"name\":\"%s\",\"calls\":%u,\"allocs\":%u,\"bytes\":%u,"
+                "\"peak\":%u,\"lastPeak\":%u,\"retained\":%d,"
+                "\"largestBefore\":%u,\"largestAfter\":%u,\"minLargest\":%u,"
+                "\"budget\":%u,\"over\":%u}",
+                i ? "," : "", s.name, (unsigned)s.calls, (unsigned)s.allocs, (unsigned)s.bytes,
+                (unsigned)s.peak, (unsigned)s.lastPeak, (int)s.lastRetained,
+                (unsigned)s.largestBefore, (unsigned)s.largestAfter,
+                (unsigned)(s.calls ? s.minLargestAfter : 0),
+                (unsigned)s.budget, (unsigned)s.overBudget);
+            _server->sendContent(buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+        }
+#endif
+        _server->sendContent("]}");
+        _server->sendContent("");
+    });
+
+    // ======================================================
+    // DIAGNÓSTICO DE TRAVAMENTOS
+    // ======================================================
+    // GET /diag/stalls          → contadores e piores fases
+    // GET /diag/stalls?reset=1  → zera os contadores
+    // Accept: application/cbor  → idem em CBOR
+    route("/diag/stalls", [this]() {
+        if (_server->hasArg("reset")) Stall.reset();
+
+        if (wantsCbor()) {
+            uint8_t buf[CBOR_CHUNK];
+            CborWriter w = beginCbor(buf, sizeof(buf));
+            w.map(7);
+            w.key("budgetMs");    w.uinteger(Stall.budgetMs());
+            w.key("loops");       w.uinteger(Stall.loops());
+            w.key("stalls");      w.uinteger(Stall.stalls());
+            w.key("worstMs");     w.uinteger(Stall.worstLoopMs());
+            w.key("resetReason");
+            if (Stall.resetReason()) w.text(Stall.resetReason());
+            else                     w.null();
+            w.key("resetPhase");  w.text(Stall.resetPhase());
+            w.key("phases");
+            w.array(Stall.count());
+            for (size_t i = 0; i < Stall.count(); i++) {
+                const StallPhaseStats& s = Stall.at(i);
+                w.map(6);
+                w.key("name");         w.text(s.name);
+                w.key("stalls");       w.uinteger(s.stalls);
+                w.key("totalMs");      w.uinteger(s.totalMs);
+                w.key("worstMs");      w.uinteger(s.worstMs);
+                w.key("worstPhaseMs"); w.uinteger(s.worstPhaseMs);
+                w.key("lastAt");       w.uinteger(s.lastAt);
+            }
+            endCbor(w);
+            return;
+        }
+
+        char buf[320];
+        int n = snprintf(buf, sizeof(buf),
+            "{\"budgetMs\":%lu,\"loops\":%lu,\"stalls\":%lu,\"worstMs\":%lu,"
+            "\"resetReason\":\"%s\",\"resetPhase\":\"%s\",\"phases\":[",
+            (unsigned long)Stall.budgetMs(), (unsigned long)Stall.loops(),
+            (unsigned long)Stall.stalls(), (unsigned long)Stall.worstLoopMs(),
+            Stall.resetReason() ? Stall.resetReason() : "",
+            Stall.resetPhase());
+
+        _server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _server->send(200, "application/json", "");
+        _server->sendContent(buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+
+        for (size_t i = 0; i < Stall.count(); i++) {
+            const StallPhaseStats& s = Stall.at(i);
+            n = snprintf(buf, sizeof(buf),
+                "%s{\"name\":\"%s\",\"stalls\":%lu,\"totalMs\":%lu,\"worstMs\":%lu,"
+                "\"worstPhaseMs\":%lu,\"lastAt\":%lu}",
+                i ? "," : "", s.name, (unsigned long)s.stalls, (unsigned long)s.totalMs,
+                (unsigned long)s.worstMs, (unsigned long)s.worstPhaseMs, (unsigned long)s.lastAt);
+            _server->sendContent(buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+        }
+        _server->sendContent("]}");
+        _server->sendContent("");
+    });
+
+    // ======================================================
+    // USO (tempo ligada, acionamentos, kWh)
+    // ======================================================
+    // Lido direto dos bins pré-agregados; nada de varrer histórico
+    route("/usage", [this]() {
+        const UsageData& u = _usage->data();
+        char kwh[16];
+        formatKwh(kwh, sizeof(kwh), u.totalOnSec, _config->get().lampWatts);
+
+        char buf[192];
+        int n = snprintf(buf, sizeof(buf),
+            "{\"synced\":%s,\"on\":%s,\"since\":%lu,\"watts\":%u,"
+            "\"total\":{\"onSec\":%lu,\"switches\":%lu,\"kWh\":%s}",
+            _usage->synced() ? "true" : "false", _usage->on() ? "true" : "false",
+            (unsigned long)u.since, (unsigned)_config->get().lampWatts,
+            (unsigned long)u.totalOnSec, (unsigned long)u.totalSwitches, kwh);
+
+        _server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+        _server->send(200, "application/json", "");
+        _server->sendContent(buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+        sendUsageBins("hours",  USAGE_HOUR);
+        sendUsageBins("days",   USAGE_DAY);
+        sendUsageBins("months", USAGE_MONTH);
+        _server->sendContent("}");
+        _server->sendContent("");
+    });
+
+    // ======================================================
+    // LISTAR REDES Wi-Fi
+    // ======================================================
+    // O scan é do WifiManager (roaming usa o mesmo); aqui só se lê o cache
+    // e se pede um novo quando ele envelhece. Aceita CBOR como /status.
+    route("/scan", [this]() {
+        if (!_wifi->scanCount() || _wifi->scanAge() > SCAN_FRESH_MS) _wifi->requestScan();
+
+        const ConfigData& c = _config->get();
+        if (wantsCbor()) {
+            uint8_t buf[CBOR_CHUNK];
+            CborWriter w = beginCbor(buf, sizeof(buf));
+            w.array(_wifi->scanCount());
+            for (size_t i = 0; i < _wifi->scanCount(); i++) {
+                const WifiScanEntry& e = _wifi->scanEntry(i);
+                w.map(3);
+                w.key("ssid");  w.text(e.ssid);
+                w.key("rssi");  w.integer(e.rssi);
+                w.key("saved"); w.boolean(Config::findNetwork(c, e.ssid) >= 0);
+            }
+            endCbor(w);
             return;
         }
 
         String json = "[";
-        for (int i = 0; i < n; i++) {
+        for (size_t i = 0; i < _wifi->scanCount(); i++) {
+            const WifiScanEntry& e = _wifi->scanEntry(i);
             if (i) json += ",";
-            json += "{\"ssid\":\"" + WiFi.SSID(i) + "\",\"rssi\":" + String(WiFi.RSSI(i)) + "}";
+            json += "{\"ssid\":";
+            appendJsonString(json, e.ssid);
+            json += ",\"rssi\":" + String(e.rssi);
+            json += ",\"saved\":";
+            json += Config::findNetwork(c, e.ssid) >= 0 ? "true" : "false";
+            json += "}";
         }
         json += "]";
 
-        WiFi.scanDelete();
-        WiFi.scanNetworks(true); // iniciar próximo scan assíncrono
-
         _server->send(200, "application/json", json);
     });
 
     // ======================================================
     // Salvar Wi-Fi
     // ======================================================
-    _server->on("/setwifi", [this]() {
+    route("/setwifi", [this]() {
         String ssid = _server->arg("ssid");
         String pass = _server->arg("pass");
 
@@ -455,54 +931,178 @@ void WebPage::setupRoutes() {
             return;
         }
 
-        Preferences prefs;
-        prefs.begin("wifi", false);
-        prefs.putString("ssid", ssid);
-        prefs.putString("pass", pass);
-        prefs.end();
+        // Entra no topo da lista; o WifiManager troca para ela se estiver visível
+        ConfigData next = _config->get();
+        if (!Config::addNetwork(next, ssid.c_str(), pass.c_str())) {
+            _server->send(400, "text/plain", "SSID ou senha muito longos!");
+            return;
+        }
+
+        if (!_config->commit(next)) {
+            _server->send(500, "text/plain", "Falha ao salvar!");
+            return;
+        }
 
-        _server->send(200, "text/plain", "Wi-Fi salvo. Reiniciando...");
-        delay(800);
-        ESP.restart();
+        LOGI("WEB", "Wi-Fi salvo: %s", ssid.c_str());
+        _server->send(200, "text/plain", "Wi-Fi salvo. Conectando...");
+    });
+
+    // ======================================================
+    // REDES SALVAS (JSON)
+    // ======================================================
+    // GET  /api/wifi → estado da conexão + redes em ordem de prioridade
+    // POST /api/wifi → action=add (ssid, pass) | remove (ssid) | top (ssid)
+    route("/api/wifi", [this]() {
+        if (_server->method() != HTTP_POST) {
+            sendWifiJson(200, nullptr);
+            return;
+        }
+
+        String action = _server->arg("action");
+        String ssid = _server->arg("ssid");
+        ConfigData next = _config->get();
+        int8_t at = Config::findNetwork(next, ssid.c_str());
+
+        bool ok;
+        if (action == "add") {
+            ok = Config::addNetwork(next, ssid.c_str(), _server->arg("pass").c_str());
+        } else if (action == "remove") {
+            ok = Config::removeNetwork(next, ssid.c_str());
+        } else if (action == "top") {
+            // Mesma senha, só sobe para o topo
+            ok = at >= 0 && Config::addNetwork(next, ssid.c_str(), next.nets[at].pass);
+        } else {
+            sendWifiJson(400, "Ação inválida");
+            return;
+        }
+
+        if (!ok) {
+            sendWifiJson(400, "Rede inválida");
+            return;
+        }
+        if (!_config->commit(next)) {
+            sendWifiJson(500, "Falha ao gravar");
+            return;
+        }
+        sendWifiJson(200, nullptr);
+    });
+
+    // ======================================================
+    // CONFIGURAÇÃO (JSON)
+    // ======================================================
+    // GET  /api/config → configuração atual (sem a senha)
+    // POST /api/config → mqttHost, mqttPort, topic, hostname, loopBudgetMs,
+    //                    lampWatts, mqttCbor (qualquer subconjunto, form ou query); ssid/pass
+    //                    põem a rede no topo da lista, como /setwifi
+    route("/api/config", [this]() {
+        if (_server->method() != HTTP_POST) {
+            sendConfigJson(200, nullptr, false);
+            return;
+        }
+
+        ConfigData next = _config->get();
+
+        struct Field { const char* arg; char* dst; size_t cap; };
+        Field fields[] = {
+            {"mqttHost", next.mqttHost, sizeof(next.mqttHost)},
+            {"topic",    next.topic,    sizeof(next.topic)},
+            {"hostname", next.hostname, sizeof(next.hostname)},
+        };
+        for (Field& f : fields) {
+            if (!_server->hasArg(f.arg)) continue;
+            if (!Config::assign(f.dst, f.cap, _server->arg(f.arg).c_str())) {
+                sendConfigJson(400, "Valor muito longo", false);
+                return;
+            }
+        }
+
+        if (_server->hasArg("ssid")) {
+            // Sem "pass", uma rede já salva mantém a senha que tinha
+            String ssid = _server->arg("ssid");
+            int8_t at = Config::findNetwork(next, ssid.c_str());
+            String pass = _server->hasArg("pass") ? _server->arg("pass")
+                        : at >= 0 ? String(next.nets[at].pass) : String();
+            if (!Config::addNetwork(next, ssid.c_str(), pass.c_str())) {
+                sendConfigJson(400, "Rede inválida", false);
+                return;
+            }
+        }
+
+        if (_server->hasArg("mqttPort")) {
+            long port = _server->arg("mqttPort").toInt();
+            if (port <= 0 || port > 65535) {
+                sendConfigJson(400, "Porta MQTT inválida", false);
+                return;
+            }
+            next.mqttPort = port;
+        }
+
+        if (_server->hasArg("loopBudgetMs")) {
+            next.loopBudgetMs = constrain(_server->arg("loopBudgetMs").toInt(), 0, 65535);
+        }
+
+        if (_server->hasArg("lampWatts")) {
+            next.lampWatts = constrain(_server->arg("lampWatts").toInt(), 0, 65535);
+        }
+
+        if (_server->hasArg("mqttCbor")) {
+            String v = _server->arg("mqttCbor");
+            next.mqttCbor = v == "1" || v == "true";
+        }
+
+        const char* error = Config::validate(next);
+        if (error) {
+            sendConfigJson(400, error, false);
+            return;
+        }
+
+        bool restart = Config::needsRestart(_config->get(), next);
+        if (!_config->commit(next)) {
+            sendConfigJson(500, "Falha ao gravar", false);
+            return;
+        }
+
+        sendConfigJson(200, nullptr, restart);
+        if (restart) scheduleRestart(800);
     });
 
     // ======================================================
     // OTA
     // ======================================================
-    _server->on("/update", HTTP_POST,
+    route("/update", HTTP_POST,
         [this]() {
             if (Update.hasError()) {
                 _server->send(500, "text/plain", "❌ Erro na atualização!");
             } else {
                 _server->send(200, "text/plain", "✅ Atualizado! Reiniciando...");
             }
-            delay(800);
-            ESP.restart();
+            scheduleRestart(800);
         },
         [this]() {
             HTTPUpload& up = _server->upload();
+            Stall.feed();   // um bloco por chamada; o upload todo é uma iteração só
 
             if (up.status == UPLOAD_FILE_START) {
-                Serial.printf("OTA inicio: %s\n", up.filename.c_str());
+                LOGI("OTA", "Inicio: %s", up.filename.c_str());
                 Update.begin(UPDATE_SIZE_UNKNOWN, U_FLASH);
             }
 
             else if (up.status == UPLOAD_FILE_WRITE) {
                 size_t written = Update.write(up.buf, up.currentSize);
                 if (written != up.currentSize) {
-                    Update.printError(Serial);
+                    LOGE("OTA", "Falha na escrita: %s", Update.errorString());
                 }
             }
 
             else if (up.status == UPLOAD_FILE_END) {
                 if (!Update.end(true)) {
-                    Update.printError(Serial);
+                    LOGE("OTA", "Falha ao finalizar: %s", Update.errorString());
                 }
             }
         }
         );
 
-    _server->on("/config", [this]() {
+    route("/config", [this]() {
     String html = R"rawliteral(
         <!DOCTYPE html>
         <html>
@@ -520,10 +1120,27 @@ void WebPage::setupRoutes() {
                 #passBox { display:none; margin-top:20px; }
                 button { padding:10px 20px; border-radius:8px; border:none;
                         color:white; background:#0077cc; cursor:pointer; }
+                .field { margin-bottom:10px; }
+                .field input { width:100%; padding:10px; box-sizing:border-box; }
+                #cfgMsg { margin-top:10px; }
             </style>
         </head>
         <body>
 
+        <h2>MQTT e Dispositivo</h2>
+        <div class="field">Host MQTT <input id="mqttHost"></div>
+        <div class="field">Porta MQTT <input id="mqttPort" type="number" min="1" max="65535"></div>
+        <div class="field">Tópico <input id="topic"></div>
+        <div class="field">Hostname <input id="hostname"></div>
+        <div class="field">Orçamento do loop (ms) <input id="loopBudgetMs" type="number" min="5" max="5000"></div>
+        <div class="field">Potência da lâmpada (W, 0 = sem estimativa) <input id="lampWatts" type="number" min="0" max="5000"></div>
+        <div class="field"><label><input id="mqttCbor" type="checkbox" style="width:auto"> Publicar estado também em CBOR (&lt;tópico&gt;/cbor)</label></div>
+        <button onclick="saveConfig()">Salvar</button>
+        <p id="cfgMsg"></p>
+
+        <h2>Redes Salvas</h2>
+        <div id="saved">Carregando...</div>
+
         <h2>Selecione a Rede Wi-Fi</h2>
         <div id="list">Buscando redes...</div>
 
@@ -561,11 +1178,69 @@ void WebPage::setupRoutes() {
             let pass = document.getElementById("pass").value;
             fetch(`/setwifi?ssid=${selectedSSID}&pass=${pass}`)
                 .then(r => r.text())
-                .then(t => alert(t));
+                .then(t => { alert(t); loadSaved(); });
+        }
+
+        // ---------------- Redes salvas ----------------
+        function loadSaved() {
+            fetch('/api/wifi')
+            .then(r => r.json())
+            .then(renderSaved);
+        }
+
+        function renderSaved(w) {
+            if (!w.ok) alert(w.error);
+
+            let out = "";
+            w.networks.forEach((n, i) => {
+                const cur = (w.connected && w.current === i) ? ` ✅ ${w.rssi} dBm` : "";
+                out += `<div class='wifi'>${i + 1}. ${n.ssid}${cur}<br><br>
+                            <button onclick='wifiAction("top", "${n.ssid}")'>Prioridade ↑</button>
+                            <button onclick='wifiAction("remove", "${n.ssid}")'>Remover</button>
+                        </div>`;
+            });
+            document.getElementById("saved").innerHTML = out || "<i>Nenhuma rede salva</i>";
+        }
+
+        function wifiAction(action, ssid) {
+            if (action === "remove" && !confirm("Remover " + ssid + "?")) return;
+            const body = new URLSearchParams({action, ssid});
+            fetch('/api/wifi', {method:'POST', body})
+            .then(r => r.json())
+            .then(renderSaved);
+        }
+
+        // ---------------- MQTT / dispositivo ----------------
+        const CFG_FIELDS = ["mqttHost", "mqttPort", "topic", "hostname", "loopBudgetMs", "lampWatts"];
+
+        function loadConfig() {
+            fetch('/api/config')
+            .then(r => r.json())
+            .then(c => {
+                CFG_FIELDS.forEach(f => document.getElementById(f).value = c[f]);
+                document.getElementById("mqttCbor").checked = c.mqttCbor;
+            });
+        }
+
+        function saveConfig() {
+            const body = new URLSearchParams();
+            CFG_FIELDS.forEach(f => body.append(f, document.getElementById(f).value));
+            body.append("mqttCbor", document.getElementById("mqttCbor").checked ? 1 : 0);
+
+            fetch('/api/config', {method:'POST', body})
+            .then(r => r.json())
+            .then(c => {
+                const msg = document.getElementById("cfgMsg");
+                if (!c.ok) msg.innerText = "❌ " + c.error;
+                else if (c.restart) msg.innerText = "✅ Salvo. Reiniciando...";
+                else msg.innerText = "✅ Salvo e aplicado.";
+            });
         }
 
         setInterval(load, 3000);
         load();
+        loadSaved();
+        loadConfig();
         </script>
 
         </body></html>
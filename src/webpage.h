@@ -5,27 +5,66 @@
 #include <WiFi.h>
 #include <Update.h>
 #include <Preferences.h>
+#include "config.h"
+#include "wifimgr.h"
+#include "usage.h"
+#include "cmdbus.h"
+#include "cbor.h"
+
+#define HISTORY_LEN 20   // últimas transições guardadas para /status
 
 class WebPage {
 public:
     WebPage(WebServer* server);
 
     void setNetworkInfo(IPAddress ip, String mac);
-    void setStatus(bool lampOn);
+    void setStatus(const Transition& t);
     void onToggle(std::function<void(void)> cb);
+    void setConfig(Config* config);
+    void setWifi(WifiManager* wifi);
+    void setUsage(UsageMeter* usage);
 
     void setupRoutes();
+    void loop();
 
 private:
     WebServer* _server;
     IPAddress _ip;
     String _mac;
     bool _lampOn = false;
+    uint32_t _seq = 0;
 
-    String _historico = "";
+    // Anel fixo: o histórico não cresce com o uptime
+    struct HistoryEntry {
+        Transition t;
+        time_t     wall;
+    };
+    HistoryEntry _history[HISTORY_LEN];
+    size_t _historyHead = 0;    // próxima posição a escrever
+    size_t _historyCount = 0;
     std::function<void(void)> _callback;
+    Config* _config = nullptr;
+    WifiManager* _wifi = nullptr;
+    UsageMeter* _usage = nullptr;
+    uint32_t _restartAt = 0;   // 0 = nenhum restart agendado
+
+    void scheduleRestart(uint32_t delayMs);
+    void sendConfigJson(int code, const char* error, bool restart);
+    void sendWifiJson(int code, const char* error);
+    void sendUsageBins(const char* name, UsagePeriod period);
+
+    // Negociação por Accept: application/cbor (ou ?fmt=cbor)
+    bool wantsCbor();
+    CborWriter beginCbor(uint8_t* buf, size_t cap);
+    void endCbor(CborWriter& w);
 
     String getWifiBars(int rssi);
+    String historyHtml();
+
+    void route(const char* uri, WebServer::THandlerFunction fn);
+    void route(const char* uri, HTTPMethod method, WebServer::THandlerFunction fn);
+    void route(const char* uri, HTTPMethod method,
+               WebServer::THandlerFunction fn, WebServer::THandlerFunction ufn);
 };
 
 #endif
@@ -0,0 +1,418 @@
+#include "wifimgr.h"
+#include "log.h"
+
+#define WIFI_SCAN_TIMEOUT_MS 15000
+
+// =========================
+// BOOT (bloqueante)
+// =========================
+void WifiManager::begin(Config* config) {
+    _config = config;
+
+    WiFi.setHostname(config->get().hostname);
+    WiFi.mode(WIFI_STA);
+    // Quem escolhe para onde reconectar é o gerenciador, não o driver
+    WiFi.setAutoReconnect(false);
+
+    LOGI("WiFi", "Procurando redes salvas...");
+    int16_t n = WiFi.scanNetworks();
+    _lastScan = millis();
+    if (n >= 0) storeScan(n);
+    WiFi.scanDelete();
+
+    // Redes ocultas não aparecem no scan: entram no fim, sem BSSID
+    buildCandidates(true);
+
+    while (_candIdx < _candCount) {
+        if (!connectTo(_cand[_candIdx++])) continue;
+
+        while (WiFi.status() != WL_CONNECTED && (int32_t)(millis() - _deadline) < 0) {
+            delay(300);
+        }
+        if (WiFi.status() == WL_CONNECTED) {
+            enterConnected();
+            return;
+        }
+        LOGW("WiFi", "STA falhou.");
+    }
+
+    startAP();
+}
+
+// =========================
+// LOOP
+// =========================
+void WifiManager::loop() {
+    uint32_t now = millis();
+
+    if (_scanning) {
+        int16_t n = WiFi.scanComplete();
+        bool timedOut = now - _scanStarted > WIFI_SCAN_TIMEOUT_MS;
+        if (n == WIFI_SCAN_RUNNING && !timedOut) return;
+
+        // Scan que falhou mantém o cache anterior, mas libera quem esperava
+        if (n >= 0) storeScan(n);
+        else LOGW("WiFi", "Scan falhou (%d)", n);
+        WiFi.scanDelete();
+        _scanning = false;
+
+        ScanPurpose purpose = _purpose;
+        _purpose = SCAN_NONE;
+        onScanDone(purpose, now);
+    }
+
+    switch (_state) {
+        case ST_CONNECTED:  loopConnected(now);  break;
+        case ST_CONNECTING: loopConnecting(now); break;
+        case ST_AP:         loopAP(now);         break;
+    }
+}
+
+void WifiManager::loopConnected(uint32_t now) {
+    if (WiFi.status() != WL_CONNECTED) {
+        LOGW("WiFi", "Conexão perdida, procurando redes salvas...");
+        _state = ST_CONNECTING;
+        _rounds = 0;
+        _roaming = false;
+        _fromAP = false;
+        _candIdx = _candCount = 0;
+        startScan(SCAN_RECONNECT);
+        return;
+    }
+
+    // Média móvel exponencial (peso 1/4) para não reagir a um pico só
+    if (now - _lastSample >= WIFI_RSSI_SAMPLE_MS) {
+        _lastSample = now;
+        int rssi = WiFi.RSSI();
+        if (rssi) _rssiAvg = (_rssiAvg * 3 + rssi) / 4;
+    }
+
+    if (_scanning || now - _lastRoam < WIFI_ROAM_DWELL_MS) return;
+
+    uint32_t sinceScan = now - _lastScan;
+    bool weak    = _rssiAvg < WIFI_ROAM_RSSI && sinceScan >= WIFI_SCAN_INTERVAL_MS;
+    bool upgrade = _net > 0 && sinceScan >= WIFI_UPGRADE_SCAN_MS;
+
+    if (weak || upgrade || _rescan) {
+        _rescan = false;
+        LOGD("WiFi", "Scan de roaming (média %d dBm, prioridade %d)", _rssiAvg, _net);
+        startScan(SCAN_ROAM);
+    }
+}
+
+void WifiManager::loopConnecting(uint32_t now) {
+    if (_scanning) return;   // esperando o scan de reconexão
+
+    if (WiFi.status() == WL_CONNECTED) {
+        enterConnected();
+        return;
+    }
+
+    if ((int32_t)(now - _deadline) >= 0) {
+        LOGW("WiFi", "STA falhou.");
+        tryNext();
+    }
+}
+
+void WifiManager::loopAP(uint32_t now) {
+    if (_scanning) return;
+
+    // Rede nova pela UI: quem está no AP é quem pediu a troca
+    if (!_apRetryNow) {
+        if (now - _lastApRetry < WIFI_AP_RETRY_MS) return;
+        _lastApRetry = now;
+
+        // Trocar de canal derruba quem está configurando pelo AP
+        if (WiFi.softAPgetStationNum() > 0) {
+            LOGD("WiFi", "Cliente no AP, retorno ao STA adiado");
+            return;
+        }
+    }
+    _apRetryNow = false;
+    _lastApRetry = now;
+
+    LOGI("WiFi", "Procurando redes salvas a partir do AP...");
+    startScan(SCAN_AP_RETRY);
+}
+
+// =========================
+// SCAN
+// =========================
+void WifiManager::requestScan() {
+    // Scan no meio de uma associação atrapalha a própria associação
+    if (_scanning || _state == ST_CONNECTING) return;
+    startScan(SCAN_UI);
+}
+
+// Um scan só por vez: um pedido novo no meio de outro só troca o motivo
+void WifiManager::startScan(ScanPurpose purpose) {
+    _purpose = purpose;
+    if (_scanning) return;
+
+    WiFi.scanDelete();
+    WiFi.scanNetworks(true);
+    _scanning = true;
+    _scanStarted = _lastScan = millis();
+}
+
+void WifiManager::storeScan(int16_t n) {
+    _scanCount = 0;
+    for (int16_t i = 0; i < n && _scanCount < WIFI_SCAN_MAX; i++) {
+        const uint8_t* bssid = WiFi.BSSID(i);
+        if (!bssid) continue;
+
+        WifiScanEntry& e = _scan[_scanCount++];
+        strncpy(e.ssid, WiFi.SSID(i).c_str(), sizeof(e.ssid) - 1);
+        e.ssid[sizeof(e.ssid) - 1] = '\0';
+        e.rssi = WiFi.RSSI(i);
+        e.channel = WiFi.channel(i);
+        memcpy(e.bssid, bssid, 6);
+    }
+    _scanAt = millis();
+}
+
+void WifiManager::onScanDone(ScanPurpose purpose, uint32_t now) {
+    switch (purpose) {
+        case SCAN_ROAM:
+            if (_state == ST_CONNECTED) evaluateRoam(now);
+            break;
+
+        case SCAN_RECONNECT:
+            if (_state != ST_CONNECTING) break;
+            buildCandidates(true);
+            tryNext();
+            break;
+
+        case SCAN_AP_RETRY:
+            if (_state != ST_AP) break;
+            buildCandidates(false);
+            if (!_candCount) {
+                LOGI("WiFi", "Nenhuma rede salva visível, mantendo AP");
+                break;
+            }
+            _fromAP = true;
+            tryNext();
+            break;
+
+        default:
+            break;
+    }
+}
+
+// =========================
+// CANDIDATOS
+// =========================
+// Sinal utilizável primeiro; depois prioridade da lista; depois RSSI
+static bool betterThan(int8_t netA, int8_t rssiA, int8_t netB, int8_t rssiB) {
+    bool usableA = rssiA >= WIFI_USABLE_RSSI;
+    bool usableB = rssiB >= WIFI_USABLE_RSSI;
+    if (usableA != usableB) return usableA;
+    if (netA != netB) return netA < netB;
+    return rssiA > rssiB;
+}
+
+void WifiManager::buildCandidates(bool withHidden) {
+    const ConfigData& cfg = _config->get();
+    _candCount = 0;
+    _candIdx = 0;
+
+    for (size_t i = 0; i < _scanCount && _candCount < WIFI_MAX_CANDIDATES; i++) {
+        int8_t net = Config::findNetwork(cfg, _scan[i].ssid);
+        if (net < 0) continue;
+
+        Candidate c;
+        c.net = net;
+        c.rssi = _scan[i].rssi;
+        c.channel = _scan[i].channel;
+        memcpy(c.bssid, _scan[i].bssid, 6);
+        c.hasBssid = true;
+
+        // Inserção ordenada: são no máximo WIFI_MAX_CANDIDATES
+        size_t at = _candCount++;
+        while (at && betterThan(c.net, c.rssi, _cand[at - 1].net, _cand[at - 1].rssi)) {
+            _cand[at] = _cand[at - 1];
+            at--;
+        }
+        _cand[at] = c;
+    }
+
+    if (!withHidden) return;
+
+    for (int8_t net = 0; net < WIFI_MAX_NETS && cfg.nets[net].ssid[0]; net++) {
+        if (_candCount == WIFI_MAX_CANDIDATES) break;
+
+        bool seen = false;
+        for (size_t i = 0; i < _candCount && !seen; i++) seen = _cand[i].net == net;
+        if (seen) continue;
+
+        Candidate& c = _cand[_candCount++];
+        memset(&c, 0, sizeof(c));
+        c.net = net;
+        c.rssi = -127;
+    }
+}
+
+void WifiManager::evaluateRoam(uint32_t now) {
+    buildCandidates(false);
+
+    const uint8_t* cur = WiFi.BSSID();
+    for (size_t i = 0; i < _candCount; i++) {
+        Candidate c = _cand[i];
+        if (cur && memcmp(c.bssid, cur, 6) == 0) continue;
+
+        // Rede menos prioritária só vale a troca com o link atual fraco
+        bool usable   = c.rssi >= WIFI_USABLE_RSSI;
+        bool upgrade  = c.rssi >= WIFI_UPGRADE_RSSI && c.net < _net;
+        bool stronger = usable && c.rssi >= _rssiAvg + WIFI_ROAM_HYSTERESIS_DB &&
+                        (c.net == _net || _rssiAvg < WIFI_ROAM_RSSI);
+        if (!upgrade && !stronger) continue;
+
+        LOGI("WiFi", "Roaming: %s (%d dBm) -> %s (%d dBm, canal %u)",
+             WiFi.SSID().c_str(), _rssiAvg, _config->get().nets[c.net].ssid,
+             c.rssi, (unsigned)c.channel);
+
+        // Se o novo não associar, volta para o BSSID de agora
+        Candidate& prev = _cand[1];
+        prev.net = _net;
+        prev.rssi = _rssiAvg;
+        prev.channel = WiFi.channel();
+        prev.hasBssid = cur != nullptr;
+        if (cur) memcpy(prev.bssid, cur, 6);
+
+        _cand[0] = c;
+        _candCount = prev.net >= 0 ? 2 : 1;
+        _candIdx = 0;
+
+        _roaming = true;
+        _fromAP = false;
+        _rounds = 0;
+        _lastRoam = now;
+        tryNext();
+        return;
+    }
+
+    LOGD("WiFi", "Nenhum candidato melhor (média %d dBm)", _rssiAvg);
+}
+
+// =========================
+// CONEXÃO
+// =========================
+bool WifiManager::connectTo(const Candidate& c) {
+    const ConfigData& cfg = _config->get();
+    if (c.net < 0 || c.net >= WIFI_MAX_NETS || !cfg.nets[c.net].ssid[0]) return false;
+
+    const WifiNet& net = cfg.nets[c.net];
+    if (c.hasBssid) {
+        LOGI("WiFi", "Tentando conectar em: %s (%02X:%02X:%02X:%02X:%02X:%02X, %d dBm)",
+             net.ssid, c.bssid[0], c.bssid[1], c.bssid[2], c.bssid[3], c.bssid[4], c.bssid[5],
+             c.rssi);
+    } else {
+        LOGI("WiFi", "Tentando conectar em: %s", net.ssid);
+    }
+
+    WiFi.disconnect();
+    WiFi.begin(net.ssid, net.pass, c.hasBssid ? c.channel : 0, c.hasBssid ? c.bssid : nullptr);
+    _deadline = millis() + WIFI_CONNECT_TIMEOUT_MS;
+    return true;
+}
+
+void WifiManager::tryNext() {
+    _state = ST_CONNECTING;
+    while (_candIdx < _candCount) {
+        // No roaming só o primeiro é troca; o seguinte é a volta
+        if (_candIdx > 0) _roaming = false;
+        if (connectTo(_cand[_candIdx++])) return;
+    }
+
+    // Acabou a lista
+    WiFi.disconnect();
+    _roaming = false;
+
+    if (_fromAP) {
+        LOGW("WiFi", "Nenhuma rede salva respondeu, mantendo AP");
+        _fromAP = false;
+        _state = ST_AP;
+        _lastApRetry = millis();
+        return;
+    }
+
+    if (_rounds < WIFI_RECONNECT_ROUNDS) {
+        _rounds++;
+        startScan(SCAN_RECONNECT);
+        return;
+    }
+
+    startAP();
+}
+
+void WifiManager::enterConnected() {
+    // Voltando do AP: derruba o AP, o STA já está associado
+    if (WiFi.getMode() != WIFI_MODE_STA) WiFi.mode(WIFI_STA);
+
+    _state = ST_CONNECTED;
+    _net = Config::findNetwork(_config->get(), WiFi.SSID().c_str());
+    _rssiAvg = WiFi.RSSI();
+    _lastSample = _lastRoam = millis();
+    if (_roaming) _roams++;
+    _roaming = false;
+    _fromAP = false;
+    _rounds = 0;
+
+    LOGI("WiFi", "Conectado em %s (%d dBm, prioridade %d). IP: %s",
+         WiFi.SSID().c_str(), _rssiAvg, _net, WiFi.localIP().toString().c_str());
+
+    if (_onChange) _onChange();
+}
+
+void WifiManager::startAP() {
+    LOGW("WiFi", "Falha ao conectar. Iniciando AP...");
+
+    // STA continua ligado para os scans de retorno
+    WiFi.mode(WIFI_AP_STA);
+
+    bool ok = WiFi.softAP(AP_SSID, AP_PASS);
+    if (!ok) {
+        LOGE("AP", "Falha ao iniciar AP!");
+    } else {
+        LOGI("AP", "AP ativo!");
+        LOGI("AP", "SSID: %s", AP_SSID);
+        LOGI("AP", "Senha: %s", AP_PASS);
+        LOGI("AP", "IP AP: %s", WiFi.softAPIP().toString().c_str());
+    }
+
+    _state = ST_AP;
+    _net = -1;
+    _roaming = false;
+    _fromAP = false;
+    _lastApRetry = millis();
+
+    if (_onChange) _onChange();
+}
+
+// =========================
+// CONFIG AO VIVO
+// =========================
+// Os índices da lista mudaram: nada de conexão guardada vale mais
+void WifiManager::networksChanged() {
+    switch (_state) {
+        case ST_AP:
+            _apRetryNow = true;   // tenta já, mesmo com cliente no AP
+            break;
+
+        case ST_CONNECTED:
+            _net = Config::findNetwork(_config->get(), WiFi.SSID().c_str());
+            if (_net < 0) {
+                LOGW("WiFi", "Rede atual removida da lista");
+                WiFi.disconnect();   // o loop reconecta em outra
+            } else {
+                // Reavalia já: pode ter entrado uma rede mais prioritária
+                _rescan = true;
+                _lastRoam = millis() - WIFI_ROAM_DWELL_MS;
+            }
+            break;
+
+        case ST_CONNECTING:
+            if (!_scanning) buildCandidates(!_fromAP);
+            break;
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef WIFIMGR_H
+#define WIFIMGR_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+#include "config.h"
+
+// =========================
+// PARÂMETROS DE ROAMING
+// =========================
+#define WIFI_CONNECT_TIMEOUT_MS 12000
+#define WIFI_RSSI_SAMPLE_MS     2000
+#define WIFI_ROAM_RSSI          -72     // média abaixo disso → procura alternativa
+#define WIFI_USABLE_RSSI        -80     // candidato mais fraco que isso só em último caso
+#define WIFI_ROAM_HYSTERESIS_DB 8       // o novo BSSID precisa ser tanto melhor
+// Subir para uma rede mais prioritária exige sinal folgadamente acima de
+// WIFI_ROAM_RSSI; senão o link novo já nasce "fraco" e o roaming por
+// sinal volta para a rede de antes, num vaivém a cada WIFI_UPGRADE_SCAN_MS
+#define WIFI_UPGRADE_RSSI       (WIFI_ROAM_RSSI + WIFI_ROAM_HYSTERESIS_DB)
+#define WIFI_ROAM_DWELL_MS      60000   // tempo mínimo entre dois roamings
+#define WIFI_SCAN_INTERVAL_MS   30000   // entre scans com sinal fraco
+#define WIFI_UPGRADE_SCAN_MS    300000  // fora da rede preferida, procura ela
+#define WIFI_AP_RETRY_MS        300000  // em AP, tenta voltar ao STA
+#define WIFI_RECONNECT_ROUNDS   3       // rodadas de scan+conexão antes do AP
+#define WIFI_SCAN_MAX           20
+#define WIFI_MAX_CANDIDATES     8
+
+#define AP_SSID "lampada_lavanderia"
+#define AP_PASS "12345678"
+
+struct WifiScanEntry {
+    char    ssid[33];
+    int8_t  rssi;
+    uint8_t channel;
+    uint8_t bssid[6];
+};
+
+// Conecta na melhor rede salva (prioridade, depois sinal) e fica de olho
+// no RSSI: com sinal fraco procura outro BSSID/rede salva e troca só se o
+// ganho passar da histerese. Sem rede, sobe o AP e tenta voltar ao STA
+// periodicamente. É o único dono do scan; /scan lê o cache daqui.
+class WifiManager {
+public:
+    void begin(Config* config);   // bloqueante, só no setup
+    void loop();
+
+    void networksChanged();
+    void requestScan();
+    void onChange(std::function<void(void)> cb) { _onChange = cb; }
+
+    bool connected() const { return _state == ST_CONNECTED; }
+    bool apMode() const { return _state == ST_AP; }
+    int8_t currentNet() const { return _net; }
+    int rssiAvg() const { return _rssiAvg; }
+    uint32_t roams() const { return _roams; }
+
+    size_t scanCount() const { return _scanCount; }
+    const WifiScanEntry& scanEntry(size_t i) const { return _scan[i]; }
+    uint32_t scanAge() const { return millis() - _scanAt; }
+
+private:
+    enum State { ST_CONNECTING, ST_CONNECTED, ST_AP };
+    enum ScanPurpose { SCAN_NONE, SCAN_UI, SCAN_ROAM, SCAN_RECONNECT, SCAN_AP_RETRY };
+
+    struct Candidate {
+        int8_t  net;
+        int8_t  rssi;
+        uint8_t channel;
+        uint8_t bssid[6];
+        bool    hasBssid;
+    };
+
+    Config*     _config = nullptr;
+    State       _state = ST_CONNECTING;
+    int8_t      _net = -1;
+    int         _rssiAvg = 0;
+    uint32_t    _roams = 0;
+    bool        _roaming = false;
+    bool        _fromAP = false;
+    bool        _apRetryNow = false;
+    bool        _rescan = false;
+    uint8_t     _rounds = 0;
+
+    uint32_t    _lastSample = 0;
+    uint32_t    _lastRoam = 0;
+    uint32_t    _lastScan = 0;
+    uint32_t    _lastApRetry = 0;
+    uint32_t    _deadline = 0;
+    uint32_t    _scanStarted = 0;
+
+    bool        _scanning = false;
+    ScanPurpose _purpose = SCAN_NONE;
+    WifiScanEntry _scan[WIFI_SCAN_MAX];
+    size_t      _scanCount = 0;
+    uint32_t    _scanAt = 0;
+
+    Candidate   _cand[WIFI_MAX_CANDIDATES + 1];
+    size_t      _candCount = 0;
+    size_t      _candIdx = 0;
+
+    std::function<void(void)> _onChange;
+
+    void startScan(ScanPurpose purpose);
+    void storeScan(int16_t n);
+    void onScanDone(ScanPurpose purpose, uint32_t now);
+    void buildCandidates(bool withHidden);
+    void evaluateRoam(uint32_t now);
+    bool connectTo(const Candidate& c);
+    void tryNext();
+    void enterConnected();
+    void startAP();
+
+    void loopConnected(uint32_t now);
+    void loopConnecting(uint32_t now);
+    void loopAP(uint32_t now);
+};
+
+#endif
@@ -0,0 +1,216 @@
+// Benchmark JSON x CBOR: as rotas com negociação de conteúdo atendidas
+// pelo firmware inteiro no host (mesmo shim do soak), uma vez com o
+// Accept padrão e outra com Accept: application/cbor. Compara bytes do
+// corpo, tempo por resposta e alocações, e confere que cada corpo CBOR
+// é exatamente um item bem formado.
+//
+//   pio run -e bench && .pio/build/bench/program --iterations 20000
+//
+// Opções: --iterations N  --aps N
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WebServer.h>
+#include <esp_heap_caps.h>
+
+#include "../../src/webpage.h"
+#include "../../src/cmdbus.h"
+
+#include <atomic>
+#include <new>
+#include <string>
+
+// Do firmware (src/main.cpp)
+void setup();
+void loop();
+extern WebServer  server;
+extern CommandBus bus;
+
+// =========================
+// CONTAGEM DE ALOCAÇÕES
+// =========================
+static std::atomic<uint64_t> g_allocs{0};
+
+static void* countedAlloc(size_t n) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return malloc(n ? n : 1);
+}
+
+void* operator new(size_t n) {
+    void* p = countedAlloc(n);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t n) { return operator new(n); }
+void* operator new(size_t n, const std::nothrow_t&) noexcept { return countedAlloc(n); }
+void* operator new[](size_t n, const std::nothrow_t&) noexcept { return countedAlloc(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// Heap fixo: /diag/heap só precisa de números estáveis
+size_t heap_caps_get_free_size(uint32_t caps) { return 200 * 1024; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps) { return 180 * 1024; }
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return 110 * 1024; }
+
+uint32_t EspClass::getFreeHeap()    { return heap_caps_get_free_size(MALLOC_CAP_8BIT); }
+uint32_t EspClass::getMinFreeHeap() { return heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT); }
+uint32_t EspClass::getMaxAllocHeap(){ return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); }
+
+// =========================
+// VALIDAÇÃO CBOR
+// =========================
+// Pula um item; nullptr se malformado ou truncado
+static const uint8_t* skipItem(const uint8_t* p, const uint8_t* end, int depth) {
+    if (p >= end || depth > 16) return nullptr;
+
+    uint8_t major = *p >> 5;
+    uint8_t info = *p & 31;
+    p++;
+
+    if (info == 31) {
+        // Só mapas e arrays indefinidos (o codificador não gera strings em partes)
+        if (major != 4 && major != 5) return nullptr;
+        while (p < end && *p != 0xFF) {
+            p = skipItem(p, end, depth + 1);
+            if (p && major == 5) p = skipItem(p, end, depth + 1);
+            if (!p) return nullptr;
+        }
+        return p < end ? p + 1 : nullptr;
+    }
+
+    uint64_t v = info;
+    if (info >= 24) {
+        if (info > 27) return nullptr;
+        size_t n = (size_t)1 << (info - 24);
+        if ((size_t)(end - p) < n) return nullptr;
+        v = 0;
+        for (size_t i = 0; i < n; i++) v = v << 8 | *p++;
+    }
+
+    switch (major) {
+        case 2:
+        case 3:
+            return (uint64_t)(end - p) >= v ? p + v : nullptr;
+        case 4:
+        case 5:
+            for (uint64_t i = 0; i < (major == 5 ? v * 2 : v); i++) {
+                p = skipItem(p, end, depth + 1);
+                if (!p) return nullptr;
+            }
+            return p;
+        case 6:
+            return skipItem(p, end, depth + 1);
+        default:
+            return p;
+    }
+}
+
+static bool wellFormed(const std::string& body) {
+    const uint8_t* p = (const uint8_t*)body.data();
+    const uint8_t* end = p + body.size();
+    return skipItem(p, end, 0) == end;
+}
+
+// =========================
+// MEDIÇÃO
+// =========================
+struct Result {
+    size_t bytes;
+    double us;        // por resposta
+    double allocs;    // por resposta
+    bool   valid;
+};
+
+static const char* ROUTES[] = {"/status", "/scan", "/diag/stalls", "/diag/heap"};
+
+static void runLoop(uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        loop();
+        soakAdvance(1);
+    }
+}
+
+static Result measure(const char* uri, bool cbor, uint32_t iterations) {
+    SoakRequest req = {HTTP_GET, uri, {}, {}, 0, 0};
+    if (cbor) req.headers.push_back({"Accept", "application/cbor"});
+
+    // Uma resposta capturada para tamanho e validação
+    std::string body;
+    server.soakBody = &body;
+    server.soakEnqueue(req);
+    server.handleClient();
+    server.soakBody = nullptr;
+
+    Result r;
+    r.bytes = body.size();
+    r.valid = !cbor || wellFormed(body);
+
+    // Fila montada antes: só o handler entra no tempo e nas alocações
+    for (uint32_t i = 0; i < iterations; i++) server.soakEnqueue(req);
+
+    uint64_t allocs = g_allocs.load();
+    uint64_t t0 = soakNowNs();
+    while (server.soakPending()) server.handleClient();
+    uint64_t ns = soakNowNs() - t0;
+
+    r.us = ns / 1000.0 / iterations;
+    r.allocs = (double)(g_allocs.load() - allocs) / iterations;
+    return r;
+}
+
+int main(int argc, char** argv) {
+    uint32_t iterations = 20000;
+    uint32_t aps = 12;
+
+    for (int i = 1; i < argc; i++) {
+        String a(argv[i]);
+        bool more = i + 1 < argc;
+        if (a == "--iterations" && more) iterations = strtoul(argv[++i], nullptr, 10);
+        else if (a == "--aps" && more)   aps = strtoul(argv[++i], nullptr, 10);
+        else {
+            fprintf(stderr, "uso: %s [--iterations N] [--aps N]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!iterations) iterations = 1;
+
+    Serial.echo = false;
+
+    // Rede salva + vizinhança para o /scan
+    WiFi.soakAps.push_back({"uaifai_IoT", "supersuper", {0x10, 0, 0, 0, 0, 1}, -52, 6});
+    for (uint32_t i = 1; i < aps; i++) {
+        char ssid[33];
+        snprintf(ssid, sizeof(ssid), "vizinho_%02lu", (unsigned long)i);
+        WiFi.soakAps.push_back({ssid, "xyz12345", {0x20, 0, 0, 0, 0, (uint8_t)i},
+                                -55 - (int32_t)(i * 3 % 40), (int32_t)(1 + i % 11)});
+    }
+
+    setup();
+    runLoop(100);
+
+    // Histórico cheio, e cada escrita no relé "demora" para haver travamentos
+    soakPinHook = [](uint8_t pin, uint8_t val) { soakAdvance(150); };
+    for (int i = 0; i < HISTORY_LEN; i++) {
+        bus.toggle(i % 2 ? SRC_MQTT : SRC_WEB);
+        runLoop(CMD_COALESCE_MS + 10);
+    }
+    soakPinHook = nullptr;
+
+    printf("== bench: %lu respostas por rota e formato, %lu APs ==\n",
+           (unsigned long)iterations, (unsigned long)aps);
+    printf("%-14s %8s %8s %6s %9s %9s %9s %9s\n", "rota", "JSON B", "CBOR B", "CBOR%",
+           "JSON us", "CBOR us", "JSON aloc", "CBOR aloc");
+
+    bool ok = true;
+    for (const char* uri : ROUTES) {
+        Result j = measure(uri, false, iterations);
+        Result c = measure(uri, true, iterations);
+        printf("%-14s %8zu %8zu %5.0f%% %9.2f %9.2f %9.1f %9.1f%s\n", uri,
+               j.bytes, c.bytes, j.bytes ? 100.0 * c.bytes / j.bytes : 0.0,
+               j.us, c.us, j.allocs, c.allocs, c.valid ? "" : "  !! CBOR inválido");
+        ok &= c.valid;
+    }
+    return ok ? 0 : 1;
+}
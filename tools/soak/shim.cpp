@@ -0,0 +1,442 @@
+// Implementação da plataforma simulada (relógio, GPIO, Serial, Wi-Fi,
+// WebServer, broker MQTT, NVS). O harness em soak.cpp dirige tudo isso.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WebServer.h>
+#include <PubSubClient.h>
+#include <Update.h>
+#include <Preferences.h>
+#include <lwip/dns.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass       ESP;
+WiFiClass      WiFi;
+UpdateClass    Update;
+SoakBroker     Broker;
+
+// =========================
+// RELÓGIO
+// =========================
+static std::atomic<uint32_t> g_ms{0};
+
+uint32_t millis() { return g_ms.load(std::memory_order_relaxed); }
+uint32_t micros() { return millis() * 1000UL; }
+void delay(uint32_t ms) { soakAdvance(ms); }
+void yield() {}
+static void dnsTick();
+void soakAdvance(uint32_t ms) {
+    g_ms.fetch_add(ms, std::memory_order_relaxed);
+    dnsTick();
+}
+
+uint64_t soakNowNs() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// =========================
+// DNS
+// =========================
+// Uma consulta por vez basta (o firmware só resolve o broker); a resposta
+// sai de soakAdvance(), na thread do loop, quando o prazo passa.
+uint32_t soakDnsDelayMs = 40;
+bool     soakDnsFail = false;
+
+struct DnsQuery {
+    String             name;
+    dns_found_callback found;
+    void*              arg;
+    uint32_t           at;
+};
+static std::vector<DnsQuery> g_dns;
+
+static bool parseIp(const char* s, uint32_t& out) {
+    unsigned a, b, c, d;
+    char tail;
+    if (sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4) return false;
+    if (a > 255 || b > 255 || c > 255 || d > 255) return false;
+    out = a | b << 8 | c << 16 | d << 24;   // ordem de rede, como no lwIP
+    return true;
+}
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* arg) {
+    if (!hostname || !*hostname) return ERR_ARG;
+    if (parseIp(hostname, addr->ip4.addr)) return ERR_OK;
+    g_dns.push_back({String(hostname), found, arg, millis() + soakDnsDelayMs});
+    return ERR_INPROGRESS;
+}
+
+static void dnsTick() {
+    while (!g_dns.empty() && (int32_t)(millis() - g_dns.front().at) >= 0) {
+        DnsQuery q = g_dns.front();
+        g_dns.erase(g_dns.begin());
+        ip_addr_t ip = {{127 | 0 << 8 | 0 << 16 | 1u << 24}};   // o broker é local
+        q.found(q.name.c_str(), soakDnsFail ? nullptr : &ip, q.arg);
+    }
+}
+
+// =========================
+// GPIO
+// =========================
+static uint8_t g_pins[40];
+std::function<void(uint8_t, uint8_t)> soakPinHook;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < sizeof(g_pins) && mode == INPUT_PULLUP) g_pins[pin] = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    if (pin >= sizeof(g_pins)) return;
+    g_pins[pin] = val;
+    if (soakPinHook) soakPinHook(pin, val);
+}
+
+int digitalRead(uint8_t pin) { return pin < sizeof(g_pins) ? g_pins[pin] : LOW; }
+void soakSetPin(uint8_t pin, uint8_t val) { if (pin < sizeof(g_pins)) g_pins[pin] = val; }
+
+// =========================
+// SERIAL
+// =========================
+size_t Print::printf(const char* fmt, ...) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+}
+
+size_t HardwareSerial::write(uint8_t c) { return write(&c, 1); }
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t n) {
+    bytesWritten += n;
+    if (echo) fwrite(buf, 1, n, stderr);
+    return n;
+}
+
+// =========================
+// FREERTOS
+// =========================
+int xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack,
+                            void* arg, unsigned prio, TaskHandle_t* handle, int core) {
+    std::thread(fn, arg).detach();
+    if (handle) *handle = nullptr;
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static thread_local char self;
+    return &self;
+}
+
+// =========================
+// WI-FI
+// =========================
+wl_status_t WiFiClass::begin(const char* ssid, const char* pass,
+                             int32_t channel, const uint8_t* bssid, bool connect) {
+    _ssid = ssid;
+    _pass = pass ? pass : "";
+    _status = WL_NO_SSID_AVAIL;
+
+    for (const SoakAp& ap : soakAps) {
+        if (ap.ssid != ssid) continue;
+        if (bssid && memcmp(bssid, ap.bssid, 6) != 0) continue;
+        if (ap.pass != _pass) {
+            _status = WL_CONNECT_FAILED;
+            continue;
+        }
+        _status  = WL_CONNECTED;
+        _rssi    = ap.rssi;
+        _channel = ap.channel;
+        memcpy(_bssid, ap.bssid, 6);
+        break;
+    }
+    return _status;
+}
+
+// O RSSI do link segue o do AP simulado; fraco demais, o link cai
+static const SoakAp* linkedAp(const std::vector<SoakAp>& aps, const uint8_t* bssid) {
+    for (const SoakAp& ap : aps) {
+        if (memcmp(ap.bssid, bssid, 6) == 0) return &ap;
+    }
+    return nullptr;
+}
+
+wl_status_t WiFiClass::status() {
+    if (_status == WL_CONNECTED) {
+        const SoakAp* ap = linkedAp(soakAps, _bssid);
+        if (!ap || ap->rssi < soakLinkLossRssi) _status = WL_CONNECTION_LOST;
+    }
+    return _status;
+}
+
+int8_t WiFiClass::RSSI() {
+    if (status() != WL_CONNECTED) return 0;
+    return linkedAp(soakAps, _bssid)->rssi;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    _status = WL_DISCONNECTED;
+    if (wifioff) _mode = WIFI_MODE_NULL;
+    return true;
+}
+
+int16_t WiFiClass::scanNetworks(bool async) {
+    if (async) {
+        _scanCount = WIFI_SCAN_RUNNING;
+        _scanDone  = millis() + soakScanMs;
+        return WIFI_SCAN_RUNNING;
+    }
+    _scan = soakAps;
+    _scanCount = _scan.size();
+    return _scanCount;
+}
+
+int16_t WiFiClass::scanComplete() {
+    if (_scanCount == WIFI_SCAN_RUNNING && (int32_t)(millis() - _scanDone) >= 0) {
+        _scan = soakAps;
+        _scanCount = _scan.size();
+    }
+    return _scanCount;
+}
+
+// =========================
+// WEBSERVER
+// =========================
+void WebServer::handleClient() {
+    if (_queue.empty()) return;
+
+    SoakRequest req = std::move(_queue.front());
+    _queue.pop_front();
+
+    _cur = &req;
+    _respCode = 404;
+    _respBytes = 0;
+
+    bool found = false;
+    for (Route& r : _routes) {
+        if (r.uri != req.uri) continue;
+        if (r.method != HTTP_ANY && r.method != req.method) continue;
+        r.fn();
+        found = true;
+        break;
+    }
+    if (!found && _notFound) _notFound();
+
+    _cur = nullptr;
+
+    if (soakOnResponse) {
+        soakOnResponse({_respCode, _respBytes, soakNowNs() - req.enqueuedNs, req.tag,
+                        millis() - req.enqueuedMs});
+    }
+}
+
+String WebServer::arg(const String& name) {
+    if (!_cur) return String();
+    for (auto& a : _cur->args) if (a.first == name) return a.second;
+    return String();
+}
+
+bool WebServer::hasArg(const String& name) {
+    if (!_cur) return false;
+    for (auto& a : _cur->args) if (a.first == name) return true;
+    return false;
+}
+
+String WebServer::header(const String& name) {
+    if (!_cur) return String();
+    for (auto& h : _cur->headers) if (h.first == name) return h.second;
+    return String();
+}
+
+// =========================
+// BROKER MQTT
+// =========================
+static bool topicMatches(const String& filter, const char* topic) {
+    if (filter == topic) return true;
+    int n = filter.length();
+    if (n >= 2 && filter[n - 1] == '#' && filter[n - 2] == '/') {
+        return strncmp(filter.c_str(), topic, n - 1) == 0 ||
+               (strlen(topic) == (size_t)(n - 2) && strncmp(filter.c_str(), topic, n - 2) == 0);
+    }
+    return false;
+}
+
+void SoakBroker::publish(const char* topic, const uint8_t* payload, size_t len, bool retained) {
+    if (!up) return;
+    published++;
+
+    if (retained) {
+        bool found = false;
+        for (size_t i = 0; i < _retained.size(); i++) {
+            if (_retained[i].topic != topic) continue;
+            found = true;
+            if (len == 0) _retained.erase(_retained.begin() + i);
+            else _retained[i].payload.assign(payload, payload + len);
+            break;
+        }
+        if (!found && len) _retained.push_back({String(topic), {payload, payload + len}});
+    }
+
+    for (PubSubClient* c : _clients) {
+        if (c->_connected && c->soakSubscribed(topic)) c->soakDeliver(topic, payload, len);
+    }
+}
+
+void SoakBroker::drop() {
+    up = false;
+    for (PubSubClient* c : _clients) {
+        c->_connected = false;
+        c->_subs.clear();
+        c->_inbox.clear();
+    }
+}
+
+void SoakBroker::attach(PubSubClient* c) {
+    for (PubSubClient* x : _clients) if (x == c) return;
+    _clients.push_back(c);
+}
+
+void SoakBroker::detach(PubSubClient* c) {
+    for (size_t i = 0; i < _clients.size(); i++) {
+        if (_clients[i] == c) { _clients.erase(_clients.begin() + i); return; }
+    }
+}
+
+void SoakBroker::subscribed(PubSubClient* c, const char* topic) {
+    for (const Retained& r : _retained) {
+        if (topicMatches(String(topic), r.topic.c_str())) {
+            c->soakDeliver(r.topic.c_str(), r.payload.data(), r.payload.size());
+        }
+    }
+}
+
+bool PubSubClient::connect(const char* id) {
+    if (!Broker.up) {
+        soakAdvance(Broker.connectTimeoutMs);
+        return false;
+    }
+    _connected = true;
+    Broker.attach(this);
+    return true;
+}
+
+void PubSubClient::disconnect() {
+    _connected = false;
+    _subs.clear();
+    _inbox.clear();
+}
+
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int len, bool retained) {
+    if (!_connected) return false;
+    Broker.publish(topic, payload, len, retained);
+    return true;
+}
+
+bool PubSubClient::subscribe(const char* topic) {
+    if (!_connected) return false;
+    _subs.push_back(String(topic));
+    Broker.subscribed(this, topic);
+    return true;
+}
+
+bool PubSubClient::unsubscribe(const char* topic) {
+    for (size_t i = 0; i < _subs.size(); i++) {
+        if (_subs[i] == topic) { _subs.erase(_subs.begin() + i); return true; }
+    }
+    return false;
+}
+
+bool PubSubClient::soakSubscribed(const char* topic) const {
+    for (const String& f : _subs) if (topicMatches(f, topic)) return true;
+    return false;
+}
+
+void PubSubClient::soakDeliver(const char* topic, const uint8_t* payload, size_t len) {
+    _inbox.push_back({String(topic), {payload, payload + len}, millis()});
+}
+
+bool PubSubClient::loop() {
+    if (!_connected) return false;
+    if (_inbox.empty()) return true;
+
+    // Um pacote por chamada, como o cliente real
+    Msg m = std::move(_inbox.front());
+    _inbox.pop_front();
+
+    uint64_t t0 = soakNowNs();
+    if (_cb) _cb((char*)m.topic.c_str(), m.payload.data(), m.payload.size());
+    if (soakOnMessage) soakOnMessage(soakNowNs() - t0, millis() - m.at);
+    return true;
+}
+
+// =========================
+// PREFERENCES
+// =========================
+static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> g_nvs;
+uint64_t Preferences::soakWrites = 0;
+
+bool Preferences::begin(const char* name, bool readOnly) {
+    _ns = &g_nvs[name];
+    _readOnly = readOnly;
+    return true;
+}
+
+bool Preferences::clear() {
+    if (!_ns || _readOnly) return false;
+    _ns->clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!_ns || _readOnly) return false;
+    return _ns->erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    return _ns && _ns->count(key);
+}
+
+size_t Preferences::putString(const char* key, const String& value) {
+    return putBytes(key, value.c_str(), value.length() + 1);
+}
+
+String Preferences::getString(const char* key, const String& def) {
+    if (!_ns) return def;
+    auto it = _ns->find(key);
+    if (it == _ns->end() || it->second.empty()) return def;
+    return String((const char*)it->second.data());
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (!_ns || _readOnly) return 0;
+    const uint8_t* p = (const uint8_t*)value;
+    (*_ns)[key].assign(p, p + len);
+    soakWrites++;
+    return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    if (!_ns) return 0;
+    auto it = _ns->find(key);
+    if (it == _ns->end() || it->second.size() > maxLen) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!_ns) return 0;
+    auto it = _ns->find(key);
+    return it == _ns->end() ? 0 : it->second.size();
+}
@@ -0,0 +1,205 @@
+#ifndef SOAK_ARDUINO_H
+#define SOAK_ARDUINO_H
+
+// Substituto mínimo do core Arduino/ESP32 para compilar o firmware no host.
+// Só cobre o que src/ usa; o relógio é virtual (avança via delay/soakAdvance).
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <functional>
+#include <string>
+
+typedef uint8_t byte;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define HIGH 1
+#define LOW  0
+
+#define INPUT        0x01
+#define OUTPUT       0x03
+#define INPUT_PULLUP 0x05
+
+// =========================
+// RELÓGIO VIRTUAL
+// =========================
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void yield();
+void soakAdvance(uint32_t ms);
+uint64_t soakNowNs();   // relógio de parede, para medir latência
+
+// =========================
+// GPIO
+// =========================
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+
+void soakSetPin(uint8_t pin, uint8_t val);
+extern std::function<void(uint8_t pin, uint8_t val)> soakPinHook;
+
+// =========================
+// STRING
+// =========================
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int v)           : _s(std::to_string(v)) {}
+    explicit String(unsigned int v)  : _s(std::to_string(v)) {}
+    explicit String(long v)          : _s(std::to_string(v)) {}
+    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+    explicit String(float v, unsigned int decimals = 2)  { fromDouble(v, decimals); }
+    explicit String(double v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+
+    unsigned int length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    const char* c_str() const { return _s.c_str(); }
+    char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    bool reserve(unsigned int n) { _s.reserve(n); return true; }
+
+    String& operator+=(const String& o) { _s += o._s; return *this; }
+    String& operator+=(const char* o) { if (o) _s += o; return *this; }
+    String& operator+=(char c) { _s += c; return *this; }
+    String& operator+=(int v) { _s += std::to_string(v); return *this; }
+    String& operator+=(unsigned int v) { _s += std::to_string(v); return *this; }
+    String& operator+=(long v) { _s += std::to_string(v); return *this; }
+    String& operator+=(unsigned long v) { _s += std::to_string(v); return *this; }
+    bool concat(const char* o, unsigned int n) { _s.append(o, n); return true; }
+
+    bool operator==(const String& o) const { return _s == o._s; }
+    bool operator==(const char* o) const { return _s == (o ? o : ""); }
+    bool operator!=(const String& o) const { return _s != o._s; }
+    bool operator!=(const char* o) const { return !(*this == o); }
+    bool equals(const String& o) const { return _s == o._s; }
+
+    bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t i = _s.find(c, from);
+        return i == std::string::npos ? -1 : (int)i;
+    }
+    int indexOf(const String& s, unsigned int from = 0) const {
+        size_t i = _s.find(s._s, from);
+        return i == std::string::npos ? -1 : (int)i;
+    }
+    String substring(unsigned int from) const {
+        return from < _s.size() ? String(_s.substr(from)) : String();
+    }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from >= _s.size() || to <= from) return String();
+        return String(_s.substr(from, to - from));
+    }
+
+    void replace(const String& find, const String& repl) {
+        if (find._s.empty()) return;
+        size_t pos = 0;
+        while ((pos = _s.find(find._s, pos)) != std::string::npos) {
+            _s.replace(pos, find._s.size(), repl._s);
+            pos += repl._s.size();
+        }
+    }
+    void trim() {
+        size_t b = _s.find_first_not_of(" \t\r\n");
+        size_t e = _s.find_last_not_of(" \t\r\n");
+        _s = (b == std::string::npos) ? std::string() : _s.substr(b, e - b + 1);
+    }
+    void toLowerCase() { for (auto& c : _s) c = tolower((unsigned char)c); }
+    long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(_s.c_str(), nullptr); }
+
+    friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+    friend String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+    friend String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+    friend String operator+(const String& a, char b) { String r(a); r += b; return r; }
+
+private:
+    std::string _s;
+
+    void fromDouble(double v, unsigned int decimals) {
+        char buf[40];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        _s = buf;
+    }
+};
+
+// =========================
+// PRINT / SERIAL
+// =========================
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t n) {
+        size_t out = 0;
+        while (n--) out += write(*buf++);
+        return out;
+    }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t println(const char* s = "") { return write(s) + write("\r\n"); }
+    size_t println(const String& s) { return println(s.c_str()); }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class HardwareSerial : public Print {
+public:
+    void begin(unsigned long) {}
+    int availableForWrite() { return 128; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buf, size_t n) override;
+    using Print::write;
+
+    uint64_t bytesWritten = 0;
+    bool echo = false;
+};
+
+extern HardwareSerial Serial;
+
+// =========================
+// ESP
+// =========================
+class EspClass {
+public:
+    void restart() { restarts++; }
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+
+    uint32_t restarts = 0;
+};
+
+extern EspClass ESP;
+
+inline void enableLoopWDT() {}
+
+// Sem SNTP no host: só aplica o fuso; time() já é o relógio do sistema
+inline void configTzTime(const char* tz, const char* server1,
+                         const char* server2 = nullptr, const char* server3 = nullptr) {
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+// =========================
+// FREERTOS
+// =========================
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void*);
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdPASS 1
+
+int  xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack,
+                             void* arg, unsigned prio, TaskHandle_t* handle, int core);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+#endif
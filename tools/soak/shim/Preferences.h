@@ -0,0 +1,39 @@
+#ifndef SOAK_PREFERENCES_H
+#define SOAK_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+// NVS em memória: namespace -> chave -> bytes. Sobrevive a "reboots"
+// simulados porque é global ao processo.
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end() { _ns = nullptr; }
+
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putString(const char* key, const String& value);
+    String getString(const char* key, const String& def = String());
+
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t getBytesLength(const char* key);
+
+    size_t   putUInt(const char* key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+    uint32_t getUInt(const char* key, uint32_t def = 0) {
+        uint32_t v = def;
+        return getBytes(key, &v, sizeof(v)) == sizeof(v) ? v : def;
+    }
+
+    static uint64_t soakWrites;
+
+private:
+    std::map<std::string, std::vector<uint8_t>>* _ns = nullptr;
+    bool _readOnly = false;
+};
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SOAK_PUBSUBCLIENT_H
+#define SOAK_PUBSUBCLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <deque>
+#include <vector>
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient;
+
+// Broker local em processo: guarda retidas, entrega para os inscritos
+// (inclusive o próprio publicador, como um broker MQTT 3.1.1 real) e
+// pode ser derrubado pelo harness.
+class SoakBroker {
+public:
+    void publish(const char* topic, const uint8_t* payload, size_t len, bool retained);
+    void drop();
+    void restore() { up = true; }
+
+    bool up = true;
+    uint64_t published = 0;
+    uint32_t connectTimeoutMs = 3000;   // connect() com broker fora bloqueia esse tempo (virtual)
+
+    void attach(PubSubClient* c);
+    void detach(PubSubClient* c);
+    void subscribed(PubSubClient* c, const char* topic);
+    bool soakRetained(const char* topic) const {
+        for (const Retained& r : _retained) if (r.topic == topic) return true;
+        return false;
+    }
+
+private:
+    struct Retained { String topic; std::vector<uint8_t> payload; };
+    std::vector<Retained> _retained;
+    std::vector<PubSubClient*> _clients;
+};
+
+extern SoakBroker Broker;
+
+class PubSubClient {
+public:
+    PubSubClient(WiFiClient& client) {}
+    ~PubSubClient() { Broker.detach(this); }
+
+    PubSubClient& setServer(const char* host, uint16_t port) { _host = host; _port = port; return *this; }
+    PubSubClient& setServer(IPAddress ip, uint16_t port) { _host = ip.toString(); _port = port; return *this; }
+    PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE) { _cb = callback; return *this; }
+    PubSubClient& setSocketTimeout(uint16_t timeout) { return *this; }
+    PubSubClient& setBufferSize(uint16_t) { return *this; }
+
+    bool connect(const char* id);
+    void disconnect();
+    bool connected() { return _connected; }
+    int  state() { return _connected ? 0 : -1; }
+
+    bool publish(const char* topic, const char* payload, bool retained = false) {
+        return publish(topic, (const uint8_t*)payload, strlen(payload), retained);
+    }
+    bool publish(const char* topic, const uint8_t* payload, unsigned int len, bool retained = false);
+    bool subscribe(const char* topic);
+    bool unsubscribe(const char* topic);
+    bool loop();
+
+    // ---- controle do harness ----
+    void soakDeliver(const char* topic, const uint8_t* payload, size_t len);
+    bool soakSubscribed(const char* topic) const;
+    // CPU do callback no host e, no relógio virtual, da publicação ao callback
+    std::function<void(uint64_t ns, uint32_t virtualMs)> soakOnMessage;
+
+private:
+    struct Msg { String topic; std::vector<uint8_t> payload; uint32_t at; };
+
+    std::function<void(char*, uint8_t*, unsigned int)> _cb;
+    String _host;
+    uint16_t _port = 0;
+    bool _connected = false;
+    std::vector<String> _subs;
+    std::deque<Msg> _inbox;
+
+    friend class SoakBroker;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef SOAK_UPDATE_H
+#define SOAK_UPDATE_H
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+
+class UpdateClass {
+public:
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH) { _written = 0; return true; }
+    size_t write(uint8_t* data, size_t len) { _written += len; return len; }
+    bool end(bool evenIfRemaining = false) { return true; }
+    bool hasError() { return false; }
+    const char* errorString() { return "No Error"; }
+    void printError(Print& out) { out.println(errorString()); }
+
+private:
+    size_t _written = 0;
+};
+
+extern UpdateClass Update;
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef SOAK_WEBSERVER_H
+#define SOAK_WEBSERVER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef enum {
+    HTTP_ANY = 0,
+    HTTP_GET,
+    HTTP_HEAD,
+    HTTP_POST,
+    HTTP_PUT,
+    HTTP_PATCH,
+    HTTP_DELETE,
+    HTTP_OPTIONS,
+} HTTPMethod;
+
+enum HTTPUploadStatus {
+    UPLOAD_FILE_START,
+    UPLOAD_FILE_WRITE,
+    UPLOAD_FILE_END,
+    UPLOAD_FILE_ABORTED,
+};
+
+#define HTTP_UPLOAD_BUFLEN 1436
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+struct HTTPUpload {
+    HTTPUploadStatus status;
+    String  filename;
+    String  name;
+    String  type;
+    size_t  totalSize;
+    size_t  currentSize;
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+// Requisição enfileirada pelo harness; cada handleClient() atende uma,
+// como o WebServer real faz com um cliente por chamada.
+struct SoakRequest {
+    HTTPMethod method;
+    String     uri;
+    std::vector<std::pair<String, String>> args;
+    std::vector<std::pair<String, String>> headers;
+    uint64_t   enqueuedNs;
+    int        tag;
+    uint32_t   enqueuedMs;   // relógio virtual; carimbado por soakEnqueue()
+};
+
+struct SoakResponse {
+    int      code;
+    size_t   bytes;
+    uint64_t latencyNs;   // CPU do host, da fila à resposta
+    int      tag;
+    uint32_t virtualMs;   // relógio do firmware: inclui loops bloqueados
+};
+
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    WebServer(int port = 80) {}
+
+    void on(const String& uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn) { on(uri, method, fn, nullptr); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+        _routes.push_back({uri, method, fn, ufn});
+    }
+    void onNotFound(THandlerFunction fn) { _notFound = fn; }
+
+    void begin() {}
+    void handleClient();
+
+    String uri() { return _cur ? _cur->uri : String(); }
+    HTTPMethod method() { return _cur ? _cur->method : HTTP_ANY; }
+    String arg(const String& name);
+    bool hasArg(const String& name);
+    int args() { return _cur ? (int)_cur->args.size() : 0; }
+
+    void collectHeaders(const char* headerKeys[], size_t count) {}
+    String header(const String& name);
+    bool hasHeader(const String& name) { return header(name).length() > 0; }
+
+    HTTPUpload& upload() { return _upload; }
+
+    void sendHeader(const String& name, const String& value, bool first = false) {
+        _respBytes += name.length() + value.length() + 4;
+    }
+    void setContentLength(size_t len) {}
+    void send(int code, const char* type = nullptr, const String& content = String()) {
+        _respCode = code;
+        _respBytes += content.length();
+        if (soakBody) soakBody->append(content.c_str(), content.length());
+    }
+    void send(int code, const String& type, const String& content) { send(code, type.c_str(), content); }
+    void send_P(int code, const char* type, const char* content, size_t len) {
+        _respCode = code;
+        _respBytes += len;
+        if (soakBody) soakBody->append(content, len);
+    }
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t len) {
+        _respBytes += len;
+        if (soakBody) soakBody->append(content, len);
+    }
+
+    // ---- controle do harness ----
+    void soakEnqueue(const SoakRequest& req) {
+        _queue.push_back(req);
+        _queue.back().enqueuedMs = millis();
+    }
+    size_t soakPending() const { return _queue.size(); }
+    std::function<void(const SoakResponse&)> soakOnResponse;
+    std::string* soakBody = nullptr;   // se setado, recebe o corpo das respostas
+
+private:
+    struct Route {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction fn;
+        THandlerFunction ufn;
+    };
+
+    std::vector<Route> _routes;
+    THandlerFunction _notFound;
+    std::deque<SoakRequest> _queue;
+    SoakRequest* _cur = nullptr;
+    HTTPUpload _upload;
+
+    int    _respCode = 0;
+    size_t _respBytes = 0;
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef SOAK_WIFI_H
+#define SOAK_WIFI_H
+
+#include <Arduino.h>
+#include <vector>
+
+class IPAddress {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _b{a, b, c, d} {}
+    uint8_t operator[](int i) const { return _b[i]; }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]);
+        return String(buf);
+    }
+
+private:
+    uint8_t _b[4];
+};
+
+typedef enum {
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA,
+} wifi_mode_t;
+
+#define WIFI_OFF   WIFI_MODE_NULL
+#define WIFI_STA   WIFI_MODE_STA
+#define WIFI_AP    WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+typedef enum {
+    WL_IDLE_STATUS     = 0,
+    WL_NO_SSID_AVAIL   = 1,
+    WL_SCAN_COMPLETED  = 2,
+    WL_CONNECTED       = 3,
+    WL_CONNECT_FAILED  = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED    = 6,
+} wl_status_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED  (-2)
+
+// Rede visível para o rádio simulado
+struct SoakAp {
+    String  ssid;
+    String  pass;
+    uint8_t bssid[6];
+    int32_t rssi;
+    int32_t channel;
+};
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t m) { _mode = m; if (!(m & WIFI_MODE_STA)) _status = WL_DISCONNECTED; return true; }
+    wifi_mode_t getMode() { return _mode; }
+    wl_status_t status();
+
+    bool setHostname(const char* name) { _hostname = name; return true; }
+    const char* getHostname() { return _hostname.c_str(); }
+
+    wl_status_t begin(const char* ssid, const char* pass = nullptr,
+                      int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true);
+    bool disconnect(bool wifioff = false, bool eraseap = false);
+    bool reconnect() { return begin(_ssid.c_str(), _pass.c_str()) == WL_CONNECTED; }
+    bool setAutoReconnect(bool) { return true; }
+
+    bool softAP(const char* ssid, const char* pass = nullptr) { _apSsid = ssid; return true; }
+    bool softAPdisconnect(bool wifioff = false) { return true; }
+    uint8_t softAPgetStationNum() { return soakApStations; }
+    IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+    IPAddress localIP() { return _status == WL_CONNECTED ? IPAddress(192, 168, 0, 50) : IPAddress(); }
+    String macAddress() { return String("24:0A:C4:00:00:01"); }
+
+    String  SSID() { return _status == WL_CONNECTED ? _ssid : String(); }
+    int8_t  RSSI();
+    uint8_t* BSSID() { return _status == WL_CONNECTED ? _bssid : nullptr; }
+    int32_t channel() { return _channel; }
+
+    int16_t scanNetworks(bool async = false);
+    int16_t scanComplete();
+    void    scanDelete() { _scanCount = WIFI_SCAN_FAILED; }
+    String  SSID(uint8_t i) { return i < _scan.size() ? _scan[i].ssid : String(); }
+    int32_t RSSI(uint8_t i) { return i < _scan.size() ? _scan[i].rssi : 0; }
+    uint8_t* BSSID(uint8_t i) { return i < _scan.size() ? _scan[i].bssid : nullptr; }
+    int32_t channel(uint8_t i) { return i < _scan.size() ? _scan[i].channel : 0; }
+
+    // ---- controle do harness ----
+    std::vector<SoakAp> soakAps;
+    void soakDrop() { if (_status == WL_CONNECTED) _status = WL_CONNECTION_LOST; }
+    uint32_t soakScanMs = 2500;
+    uint8_t  soakApStations = 0;
+    int8_t   soakLinkLossRssi = -92;   // abaixo disso o AP associado "some"
+
+private:
+    wifi_mode_t _mode = WIFI_MODE_NULL;
+    wl_status_t _status = WL_IDLE_STATUS;
+    String   _hostname, _ssid, _pass, _apSsid;
+    uint8_t  _bssid[6] = {0};
+    int8_t   _rssi = 0;
+    int32_t  _channel = 0;
+
+    std::vector<SoakAp> _scan;
+    int16_t  _scanCount = WIFI_SCAN_FAILED;
+    uint32_t _scanDone = 0;
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient {
+public:
+    bool connected() { return true; }
+};
+
+#endif
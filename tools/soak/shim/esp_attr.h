@@ -0,0 +1,8 @@
+#ifndef SOAK_ESP_ATTR_H
+#define SOAK_ESP_ATTR_H
+
+#define __NOINIT_ATTR
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef SOAK_ESP_HEAP_CAPS_H
+#define SOAK_ESP_HEAP_CAPS_H
+
+#include <Arduino.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+
+// Contabilizados pelo alocador do harness (soak.cpp). O host não reproduz
+// a fragmentação do heap do ESP32: o "maior bloco" é o livre total.
+size_t heap_caps_get_free_size(uint32_t caps);
+size_t heap_caps_get_minimum_free_size(uint32_t caps);
+size_t heap_caps_get_largest_free_block(uint32_t caps);
+
+#endif
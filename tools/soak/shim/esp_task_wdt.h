@@ -0,0 +1,13 @@
+#ifndef SOAK_ESP_TASK_WDT_H
+#define SOAK_ESP_TASK_WDT_H
+
+#include <cstdint>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+
+// O host não tem watchdog: só aceita a configuração
+inline esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic) { return ESP_OK; }
+inline esp_err_t esp_task_wdt_reset() { return ESP_OK; }
+
+#endif
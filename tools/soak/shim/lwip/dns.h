@@ -0,0 +1,28 @@
+#ifndef SOAK_LWIP_DNS_H
+#define SOAK_LWIP_DNS_H
+
+#include <stdint.h>
+
+// Resolvedor do lwIP: IP literal responde na hora; nome responde pelo
+// callback depois de soakDnsDelayMs de relógio virtual (ou falha, com
+// soakDnsFail), como a consulta assíncrona do ESP32.
+
+typedef int8_t err_t;
+#define ERR_OK          0
+#define ERR_INPROGRESS -5
+#define ERR_ARG        -16
+
+typedef struct { uint32_t addr; } ip4_addr_t;
+typedef struct { ip4_addr_t ip4; } ip_addr_t;
+#define ip_2_ip4(a)          (&(a)->ip4)
+#define ip4_addr_get_u32(a)  ((a)->addr)
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* addr, void* arg);
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* arg);
+
+// ---- controle do harness ----
+extern uint32_t soakDnsDelayMs;
+extern bool     soakDnsFail;
+
+#endif
@@ -0,0 +1,463 @@
+// Soak/load harness: roda setup()/loop() do firmware no host contra o
+// broker e os clientes HTTP simulados, injetando milhões de eventos
+// mistos, e mede vazão, latência e uso de heap ao longo do tempo.
+//
+//   pio run -e soak && .pio/build/soak/program --events 2000000
+//
+// Opções: --events N  --seed N  --sample N  --heap-limit KB  --keep-going  --verbose
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WebServer.h>
+#include <PubSubClient.h>
+#include <Preferences.h>
+#include <esp_heap_caps.h>
+
+#include "../../src/heaptrace.h"
+#include "../../src/config.h"
+#include "../../src/stall.h"
+#include "../../src/wifimgr.h"
+#include "../../src/cmdbus.h"
+
+#include <atomic>
+#include <new>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Do firmware (src/main.cpp)
+void setup();
+void loop();
+extern WebServer    server;
+extern PubSubClient mqtt;
+extern Config       config;
+extern WifiManager  wifi;
+extern CommandBus   bus;
+
+// Pinos do Mini R4 (iguais aos de src/main.cpp)
+static const uint8_t SOAK_PIN_RELAY  = 26;
+static const uint8_t SOAK_PIN_SWITCH = 27;
+
+// =========================
+// HEAP INSTRUMENTADO
+// =========================
+// Todo new/delete passa por aqui (o String simulado usa std::string).
+// O limite imita a RAM livre do ESP32 depois de Wi-Fi/lwIP subirem.
+static std::atomic<int64_t>  g_live{0};
+static std::atomic<int64_t>  g_peak{0};
+static std::atomic<uint64_t> g_allocs{0};
+static std::atomic<int64_t>  g_minFree{INT64_MAX};
+static int64_t g_heapLimit = 200 * 1024;
+static bool    g_oom = false;
+
+static const size_t HDR = 16;
+
+static void* trackedAlloc(size_t n) {
+    uint8_t* p = (uint8_t*)malloc(n + HDR);
+    if (!p) throw std::bad_alloc();
+    *(size_t*)p = n;
+
+    int64_t live = g_live.fetch_add(n, std::memory_order_relaxed) + n;
+    int64_t peak = g_peak.load(std::memory_order_relaxed);
+    while (live > peak && !g_peak.compare_exchange_weak(peak, live)) {}
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (live > g_heapLimit) g_oom = true;
+
+    int64_t free = g_heapLimit - live;
+    int64_t minFree = g_minFree.load(std::memory_order_relaxed);
+    while (free < minFree && !g_minFree.compare_exchange_weak(minFree, free)) {}
+
+#ifdef HEAP_TRACE
+    HeapTrace::onAlloc(n);
+#endif
+    return p + HDR;
+}
+
+static void trackedFree(void* ptr) {
+    if (!ptr) return;
+    uint8_t* p = (uint8_t*)ptr - HDR;
+    g_live.fetch_sub(*(size_t*)p, std::memory_order_relaxed);
+    free(p);
+}
+
+void* operator new(size_t n) { return trackedAlloc(n); }
+void* operator new[](size_t n) { return trackedAlloc(n); }
+void* operator new(size_t n, const std::nothrow_t&) noexcept {
+    try { return trackedAlloc(n); } catch (...) { return nullptr; }
+}
+void* operator new[](size_t n, const std::nothrow_t&) noexcept {
+    try { return trackedAlloc(n); } catch (...) { return nullptr; }
+}
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete[](void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, size_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { trackedFree(p); }
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    int64_t free = g_heapLimit - g_live.load(std::memory_order_relaxed);
+    return free > 0 ? (size_t)free : 0;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    int64_t free = g_minFree.load(std::memory_order_relaxed);
+    if (free == INT64_MAX) return heap_caps_get_free_size(caps);
+    return free > 0 ? (size_t)free : 0;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+uint32_t EspClass::getFreeHeap()    { return heap_caps_get_free_size(MALLOC_CAP_8BIT); }
+uint32_t EspClass::getMinFreeHeap() { return heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT); }
+uint32_t EspClass::getMaxAllocHeap(){ return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT); }
+
+// =========================
+// HISTOGRAMA DE LATÊNCIA
+// =========================
+// Log-linear (16 sub-faixas por potência de 2), sem alocação.
+class Histogram {
+public:
+    void add(uint64_t ns) {
+        _count++;
+        if (ns > _max) _max = ns;
+        _buckets[index(ns)]++;
+    }
+
+    uint64_t count() const { return _count; }
+    uint64_t max() const { return _max; }
+
+    uint64_t percentile(double p) const {
+        if (!_count) return 0;
+        uint64_t target = (uint64_t)(p * _count);
+        if (target >= _count) target = _count - 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < N; i++) {
+            seen += _buckets[i];
+            if (seen > target) return lowerBound(i);
+        }
+        return _max;
+    }
+
+private:
+    static const int SUB = 16;
+    static const int N = 64 * SUB;
+
+    uint64_t _buckets[N] = {0};
+    uint64_t _count = 0;
+    uint64_t _max = 0;
+
+    static int index(uint64_t v) {
+        if (v < SUB) return (int)v;
+        int msb = 63 - __builtin_clzll(v);
+        int sub = (int)((v >> (msb - 4)) & (SUB - 1));
+        return (msb - 3) * SUB + sub;
+    }
+    static uint64_t lowerBound(int i) {
+        if (i < SUB) return i;
+        int msb = i / SUB + 3;
+        return ((uint64_t)SUB + (i % SUB)) << (msb - 4);
+    }
+};
+
+// =========================
+// MIX DE EVENTOS
+// =========================
+enum Tag {
+    TAG_STATUS,
+    TAG_TOGGLE,
+    TAG_SCAN,
+    TAG_MQTT,
+    TAG_SWITCH,
+    TAG_COUNT
+};
+
+static const char* TAG_NAMES[TAG_COUNT] = {
+    "http /status", "http /toggle", "http /scan", "mqtt cmd", "switch S2"
+};
+
+struct Route {
+    Tag        tag;
+    HTTPMethod method;
+    const char* uri;
+};
+
+static const Route ROUTES[] = {
+    {TAG_STATUS, HTTP_GET,  "/status"},
+    {TAG_TOGGLE, HTTP_POST, "/toggle"},
+    {TAG_SCAN,   HTTP_GET,  "/scan"},
+};
+
+// Pesos em ‰ (o resto são iterações ociosas do loop)
+static const int W_HTTP   = 450;
+static const int W_MQTT   = 250;
+static const int W_SWITCH = 120;
+static const int W_DROP   = 2;
+static const int W_FADE   = 4;
+
+static uint64_t g_rng = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rnd() {
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return (uint32_t)(g_rng >> 32);
+}
+
+static uint32_t rnd(uint32_t n) { return rnd() % n; }
+
+// =========================
+// ESTADO DO HARNESS
+// =========================
+static Histogram g_lat[TAG_COUNT];    // CPU do host, ns
+static Histogram g_vlat[TAG_COUNT];   // relógio virtual do firmware, ms
+static uint64_t  g_httpErrors = 0;
+static uint64_t  g_relayWrites = 0;
+static uint64_t  g_switchFlipNs = 0;
+static uint32_t  g_switchFlipMs = 0;
+static bool      g_switchPending = false;
+static uint64_t  g_loops = 0;
+
+static void runLoop(uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; i++) {
+        loop();
+        soakAdvance(1);
+        g_loops++;
+    }
+}
+
+static void httpBurst() {
+    // 1..4 clientes simultâneos; o servidor atende um por loop()
+    int clients = 1 + rnd(4);
+    for (int c = 0; c < clients; c++) {
+        uint32_t r = rnd(100);
+        const Route& route = r < 80 ? ROUTES[0] : (r < 93 ? ROUTES[1] : ROUTES[2]);
+        SoakRequest req = {route.method, route.uri, {}, {}, soakNowNs(), route.tag};
+        // Um quarto pede CBOR, como uma integração faria
+        if (rnd(4) == 0) req.headers.push_back({"Accept", "application/cbor"});
+        server.soakEnqueue(req);
+    }
+    while (server.soakPending()) runLoop(1);
+}
+
+static void mqttCommand() {
+    const char* payload = rnd(2) ? "1" : "0";
+    Broker.publish(config.get().topic, (const uint8_t*)payload, 1, true);
+    runLoop(1 + rnd(3));
+}
+
+// Passeio aleatório no RSSI dos APs: força roaming e, às vezes, queda do link
+static void wifiFade() {
+    for (SoakAp& ap : WiFi.soakAps) {
+        ap.rssi = constrain(ap.rssi + (int32_t)rnd(13) - 6, -95, -40);
+    }
+    runLoop(1 + rnd(5));
+}
+
+static void switchEdge() {
+    // Borda com 0..3 repiques de 2..10 ms antes de estabilizar
+    uint8_t level = digitalRead(SOAK_PIN_SWITCH) == HIGH ? LOW : HIGH;
+    int bounces = rnd(4);
+    for (int b = 0; b < bounces; b++) {
+        soakSetPin(SOAK_PIN_SWITCH, level);
+        runLoop(2 + rnd(9));
+        soakSetPin(SOAK_PIN_SWITCH, level == HIGH ? LOW : HIGH);
+        runLoop(1 + rnd(3));
+    }
+    soakSetPin(SOAK_PIN_SWITCH, level);
+    // A medição fica pendente até o relé ser escrito (debounce, coalescência e
+    // um connect travado entram na conta); a próxima borda a descarta.
+    g_switchFlipNs = soakNowNs();
+    g_switchFlipMs = millis();
+    g_switchPending = true;
+    runLoop(60);
+}
+
+// =========================
+// RELATÓRIO
+// =========================
+static void printSampleHeader() {
+    printf("%10s %10s %9s %9s %9s %9s %6s %9s\n",
+           "eventos", "uptime(h)", "vivo(KB)", "pico(KB)",
+           "arena(KB)", "livre(KB)", "frag%", "aloc/ev");
+}
+
+static void printSample(uint64_t ev, uint64_t allocsBefore, uint64_t evBefore) {
+    double arenaKb = 0, freeKb = 0, frag = 0;
+#ifdef __GLIBC__
+    struct mallinfo2 mi = mallinfo2();
+    arenaKb = mi.arena / 1024.0;
+    freeKb  = mi.fordblks / 1024.0;
+    frag    = mi.arena ? 100.0 * mi.fordblks / mi.arena : 0;
+#endif
+    uint64_t allocs = g_allocs.load() - allocsBefore;
+    printf("%10llu %10.2f %9.1f %9.1f %9.1f %9.1f %6.1f %9.2f\n",
+           (unsigned long long)ev, millis() / 3600000.0,
+           g_live.load() / 1024.0, g_peak.load() / 1024.0,
+           arenaKb, freeKb, frag,
+           ev > evBefore ? (double)allocs / (ev - evBefore) : 0.0);
+}
+
+static void printHeapScopes() {
+#ifdef HEAP_TRACE
+    printf("\n%-18s %9s %9s %10s %9s %9s %6s\n",
+           "heap por escopo", "chamadas", "aloc/ch", "bytes/ch", "pico", "retido", "acima");
+    for (size_t i = 0; i < HeapTrace::count(); i++) {
+        const HeapScopeStats& s = HeapTrace::at(i);
+        if (!s.calls) continue;
+        printf("%-18s %9u %9.1f %10.1f %9u %9d %6u\n", s.name, (unsigned)s.calls,
+               (double)s.allocs / s.calls, (double)s.bytes / s.calls,
+               (unsigned)s.peak, (int)s.lastRetained, (unsigned)s.overBudget);
+    }
+#endif
+}
+
+static void printStalls() {
+    printf("\ntravamentos do loop (orçamento %lu ms): %lu de %lu iterações, pior %lu ms\n",
+           (unsigned long)Stall.budgetMs(), (unsigned long)Stall.stalls(),
+           (unsigned long)Stall.loops(), (unsigned long)Stall.worstLoopMs());
+    for (size_t i = 0; i < Stall.count(); i++) {
+        const StallPhaseStats& s = Stall.at(i);
+        printf("  %-18s %8lu travamentos, pior %lu ms (fase %lu ms)\n", s.name,
+               (unsigned long)s.stalls, (unsigned long)s.worstMs, (unsigned long)s.worstPhaseMs);
+    }
+}
+
+static void printTable(const char* title, const Histogram* lat, double div) {
+    printf("\n%-14s %10s %9s %9s %9s %9s %9s\n",
+           title, "n", "p50", "p90", "p99", "p99.9", "max");
+    for (int t = 0; t < TAG_COUNT; t++) {
+        const Histogram& h = lat[t];
+        printf("%-14s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f\n", TAG_NAMES[t],
+               (unsigned long long)h.count(),
+               h.percentile(0.50) / div, h.percentile(0.90) / div,
+               h.percentile(0.99) / div, h.percentile(0.999) / div,
+               h.max() / div);
+    }
+}
+
+// Virtual: o que o usuário veria no aparelho, com loops bloqueados.
+// Host: só o custo de CPU do caminho, útil para regressões de código.
+static void printLatencies() {
+    printTable("latência (ms)", g_vlat, 1e6);
+    printTable("CPU host (us)", g_lat, 1e3);
+}
+
+int main(int argc, char** argv) {
+    uint64_t events = 1000000;
+    uint64_t sampleEvery = 50000;
+    bool verbose = false;
+    bool keepGoing = false;
+
+    for (int i = 1; i < argc; i++) {
+        String a(argv[i]);
+        bool more = i + 1 < argc;
+        if (a == "--events" && more)          events = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--seed" && more)       g_rng ^= strtoull(argv[++i], nullptr, 10) * 0x2545F4914F6CDD1DULL;
+        else if (a == "--sample" && more)     sampleEvery = strtoull(argv[++i], nullptr, 10);
+        else if (a == "--heap-limit" && more) g_heapLimit = strtoll(argv[++i], nullptr, 10) * 1024;
+        else if (a == "--keep-going")         keepGoing = true;
+        else if (a == "--verbose")            verbose = true;
+        else {
+            fprintf(stderr, "uso: %s [--events N] [--seed N] [--sample N] [--heap-limit KB] [--keep-going] [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!sampleEvery) sampleEvery = events;
+
+    Serial.echo = verbose;
+
+    WiFi.soakAps.push_back({"uaifai_IoT", "supersuper", {0x10, 0, 0, 0, 0, 1}, -58, 6});
+    WiFi.soakAps.push_back({"uaifai_IoT", "supersuper", {0x10, 0, 0, 0, 0, 3}, -70, 1});
+    WiFi.soakAps.push_back({"vizinho",    "xyz12345",   {0x10, 0, 0, 0, 0, 2}, -81, 11});
+
+    server.soakOnResponse = [](const SoakResponse& r) {
+        if (r.code >= 400) g_httpErrors++;
+        g_lat[r.tag].add(r.latencyNs);
+        g_vlat[r.tag].add((uint64_t)r.virtualMs * 1000000);
+    };
+    mqtt.soakOnMessage = [](uint64_t ns, uint32_t virtualMs) {
+        g_lat[TAG_MQTT].add(ns);
+        g_vlat[TAG_MQTT].add((uint64_t)virtualMs * 1000000);
+    };
+    soakPinHook = [](uint8_t pin, uint8_t val) {
+        if (pin != SOAK_PIN_RELAY) return;
+        g_relayWrites++;
+        if (g_switchPending) {
+            g_lat[TAG_SWITCH].add(soakNowNs() - g_switchFlipNs);
+            g_vlat[TAG_SWITCH].add((uint64_t)(millis() - g_switchFlipMs) * 1000000);
+            g_switchPending = false;
+        }
+    };
+
+    setup();
+    runLoop(100);
+
+    printf("== soak: %llu eventos, heap limite %lld KB ==\n",
+           (unsigned long long)events, (long long)(g_heapLimit / 1024));
+    printSampleHeader();
+
+    uint64_t restoreAt = 0;
+    uint64_t drops = 0;
+    uint64_t sampleAllocs = g_allocs.load();
+    uint64_t sampleEv = 0;
+    uint64_t t0 = soakNowNs();
+    uint64_t ev = 0;
+
+    uint64_t oomAt = 0;
+
+    for (; ev < events && (keepGoing || !g_oom); ev++) {
+        if (g_oom && !oomAt) oomAt = ev ? ev : 1;
+
+        if (restoreAt && ev >= restoreAt) {
+            Broker.restore();
+            restoreAt = 0;
+        }
+
+        int r = rnd(1000);
+        if (r < W_HTTP)                                 httpBurst();
+        else if ((r -= W_HTTP) < W_MQTT)                mqttCommand();
+        else if ((r -= W_MQTT) < W_SWITCH)              switchEdge();
+        else if ((r -= W_SWITCH) < W_DROP && !restoreAt) {
+            Broker.drop();
+            restoreAt = ev + 100 + rnd(2000);
+            drops++;
+        }
+        else if ((r -= W_DROP) < W_FADE)                wifiFade();
+        else runLoop(1 + rnd(5));
+
+        if ((ev + 1) % sampleEvery == 0) {
+            printSample(ev + 1, sampleAllocs, sampleEv);
+            sampleAllocs = g_allocs.load();
+            sampleEv = ev + 1;
+        }
+    }
+
+    double wall = (soakNowNs() - t0) / 1e9;
+
+    printLatencies();
+    printHeapScopes();
+    printStalls();
+
+    printf("\nvazão: %.0f eventos/s, %.0f loops/s (%.1f s de parede, %.1f h simuladas)\n",
+           ev / wall, g_loops / wall, wall, millis() / 3600000.0);
+    printf("relé: %llu escritas | quedas do broker: %llu | HTTP >=400: %llu | restarts: %u\n",
+           (unsigned long long)g_relayWrites, (unsigned long long)drops,
+           (unsigned long long)g_httpErrors, ESP.restarts);
+    printf("barramento: %lu comandos, %lu transições, %lu dobrados, %lu descartados\n",
+           (unsigned long)bus.posted(), (unsigned long)bus.seq(),
+           (unsigned long)bus.coalesced(), (unsigned long)bus.dropped());
+    printf("wi-fi: %lu roamings, %s, média %d dBm\n",
+           (unsigned long)wifi.roams(), wifi.connected() ? "conectado" : wifi.apMode() ? "AP" : "conectando",
+           wifi.rssiAvg());
+    printf("heap: vivo %.1f KB, pico %.1f KB, %llu alocações\n",
+           g_live.load() / 1024.0, g_peak.load() / 1024.0,
+           (unsigned long long)g_allocs.load());
+
+    if (g_oom) {
+        printf("\n!! heap esgotado no evento %llu\n", (unsigned long long)(oomAt ? oomAt : ev));
+        return 1;
+    }
+    return 0;
+}